@@ -0,0 +1,60 @@
+// admission.c - token buckets limiting the rate at which a station may put frames on
+// the channel, per connection and per source MAC
+#include <stdio.h>
+#include <string.h>
+#include "admission.h"
+
+void bucket_init(TokenBucket* bucket, double rate, double burst, double now_ms) {
+	bucket->rate = rate;
+	bucket->burst = burst < 1.0 ? 1.0 : burst;
+	bucket->tokens = bucket->burst;
+	bucket->last_ms = now_ms;
+}
+
+double bucket_refill(TokenBucket* bucket, double now_ms) {
+	if (bucket->rate <= 0) {
+		return 0;
+	}
+
+	if (now_ms > bucket->last_ms) {
+		bucket->tokens += (now_ms - bucket->last_ms) * bucket->rate / 1000.0;
+		if (bucket->tokens > bucket->burst) {
+			bucket->tokens = bucket->burst;
+		}
+		bucket->last_ms = now_ms;
+	}
+
+	if (bucket->tokens >= 1.0) {
+		return 0;
+	}
+	return (1.0 - bucket->tokens) * 1000.0 / bucket->rate;
+}
+
+MacLimit* mac_limit_find(MacLimit* limits, int count, const uint8_t* mac) {
+	for (int i = 0; i < count; i++) {
+		if (memcmp(limits[i].mac, mac, 6) == 0) {
+			return &limits[i];
+		}
+	}
+	return NULL;
+}
+
+bool parse_mac(const char* text, uint8_t* mac) {
+	unsigned int bytes[6];
+	char separator[5];
+	char tail;
+
+	if (sscanf(text, "%2x%c%2x%c%2x%c%2x%c%2x%c%2x%c", &bytes[0], &separator[0], &bytes[1], &separator[1],
+		&bytes[2], &separator[2], &bytes[3], &separator[3], &bytes[4], &separator[4], &bytes[5], &tail) != 11) {
+		return false;
+	}
+	for (int i = 0; i < 5; i++) {
+		if (separator[i] != ':' && separator[i] != '-') {
+			return false;
+		}
+	}
+	for (int i = 0; i < 6; i++) {
+		mac[i] = (uint8_t)bytes[i];
+	}
+	return true;
+}
@@ -0,0 +1,46 @@
+// admission.h - token buckets limiting the rate at which a station may put frames on
+// the channel, per connection and per source MAC
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_MAC_LIMITS 64        // Source MACs with a limit of their own (-mac-rate)
+
+// One token per frame, refilled continuously at `rate` tokens per second up to `burst`
+typedef struct {
+	double rate;            // 0 = unlimited
+	double burst;
+	double tokens;
+	double last_ms;         // Time of the last refill
+} TokenBucket;
+
+// Limit for frames carrying one source MAC, shared by every connection that sends them
+typedef struct {
+	uint8_t mac[6];
+	TokenBucket bucket;
+	int64_t deferred;
+} MacLimit;
+
+// Starts a bucket full
+void bucket_init(TokenBucket* bucket, double rate, double burst, double now_ms);
+
+// Adds the tokens earned since the last refill. Returns the milliseconds until the
+// bucket holds a whole token, 0 if it does now.
+double bucket_refill(TokenBucket* bucket, double now_ms);
+
+// Spends the token of an admitted frame. Only after bucket_refill() returned 0.
+static __inline void bucket_take(TokenBucket* bucket) {
+	if (bucket->rate > 0) {
+		bucket->tokens -= 1.0;
+	}
+}
+
+// Finds the limit of a source MAC, NULL if it has none
+MacLimit* mac_limit_find(MacLimit* limits, int count, const uint8_t* mac);
+
+// Parses "xx:xx:xx:xx:xx:xx" (or '-' separated). Returns false if malformed.
+bool parse_mac(const char* text, uint8_t* mac);
+
+#endif
@@ -0,0 +1,119 @@
+// bench.h - timing, loopback socket pairs and result lines shared by the hot path
+// benchmarks (bench_channel.c, bench_server.c)
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "platform.h"
+
+// Monotonic time in milliseconds
+static double bench_now_ms(void) {
+	return now_ms();
+}
+
+// Column header of the result lines. One line per case, the case names and columns
+// never change, so runs can be diffed or parsed for regression tracking.
+static void bench_print_header(const char* program, int frame_size) {
+	printf("# %s frame_size=%d\n", program, frame_size);
+	printf("%-36s %6s %14s %16s\n", "# case", "n", "ns/op", "frames/s");
+}
+
+// Prints one result: `ops` operations took `elapsed_ms`, each handling frames_per_op frames
+static void bench_report(const char* name, int n, double elapsed_ms, long long ops, double frames_per_op) {
+	double ns_per_op = (ops > 0) ? elapsed_ms * 1e6 / (double)ops : 0.0;
+	double frames_per_sec = (elapsed_ms > 0) ? (double)ops * frames_per_op / (elapsed_ms / 1000.0) : 0.0;
+
+	printf("%-36s %6d %14.1f %16.0f\n", name, n, ns_per_op, frames_per_sec);
+	fflush(stdout);
+}
+
+// Prints a result that is a count, not a time: the count goes in the ns/op column and
+// the frames/s column is left empty
+static __inline void bench_report_count(const char* name, int n, long long count) {
+	printf("%-36s %6d %14lld %16s\n", name, n, count, "-");
+	fflush(stdout);
+}
+
+// Listening socket on an ephemeral loopback port, for bench_connect_pair()
+static SOCKET bench_listen(struct sockaddr_in* addr) {
+	SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	socklen_t addr_len = sizeof(*addr);
+
+	if (s == INVALID_SOCKET) {
+		fprintf(stderr, "Error at socket(): %d\n", WSAGetLastError());
+		return INVALID_SOCKET;
+	}
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr->sin_port = 0;
+	if (bind(s, (struct sockaddr*)addr, sizeof(*addr)) == SOCKET_ERROR ||
+		listen(s, SOMAXCONN) == SOCKET_ERROR ||
+		getsockname(s, (struct sockaddr*)addr, &addr_len) == SOCKET_ERROR) {
+		fprintf(stderr, "Cannot listen on loopback: %d\n", WSAGetLastError());
+		closesocket(s);
+		return INVALID_SOCKET;
+	}
+	return s;
+}
+
+// Connects a loopback TCP pair through the listener. Both ends are non-blocking and
+// send without Nagle delays, so a frame is readable as soon as send() returns.
+// *peer_addr receives the address of the connecting end, as accept() reports it.
+static bool bench_connect_pair(SOCKET listener, const struct sockaddr_in* addr,
+	SOCKET* near_end, SOCKET* far_end, struct sockaddr_in* peer_addr) {
+	socklen_t peer_len = sizeof(*peer_addr);
+	u_long mode = 1;
+	int nodelay = 1;
+
+	*far_end = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (*far_end == INVALID_SOCKET ||
+		connect(*far_end, (const struct sockaddr*)addr, sizeof(*addr)) == SOCKET_ERROR) {
+		fprintf(stderr, "Cannot connect loopback pair: %d\n", WSAGetLastError());
+		return false;
+	}
+	*near_end = accept(listener, (struct sockaddr*)peer_addr, &peer_len);
+	if (*near_end == INVALID_SOCKET) {
+		fprintf(stderr, "Cannot accept loopback pair: %d\n", WSAGetLastError());
+		closesocket(*far_end);
+		return false;
+	}
+	ioctlsocket(*near_end, FIONBIO, &mode);
+	ioctlsocket(*far_end, FIONBIO, &mode);
+	setsockopt(*near_end, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+	setsockopt(*far_end, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+	return true;
+}
+
+// Waits until at least `bytes` bytes are queued on a socket (gives up after a second)
+static bool bench_wait_readable(SOCKET s, int bytes) {
+	double deadline = bench_now_ms() + 1000.0;
+
+	for (;;) {
+		u_long available = 0;
+		if (ioctlsocket(s, FIONREAD, &available) == 0 && (int)available >= bytes) {
+			return true;
+		}
+		if (bench_now_ms() > deadline) {
+			return false;
+		}
+
+		PlatformPollFd fd;
+		fd.fd = s;
+		fd.events = POLLIN;
+		fd.revents = 0;
+		platform_poll(&fd, 1, 1.0);
+	}
+}
+
+// Reads and discards everything queued on a non-blocking socket
+static void bench_drain(SOCKET s) {
+	char buffer[65536];
+
+	while (recv(s, buffer, sizeof(buffer), 0) > 0) {
+	}
+}
+
+#endif
@@ -0,0 +1,300 @@
+// bench_channel.c - microbenchmarks of the channel's hot paths on loopback socket pairs:
+// buffer sizing, broadcast fan-out, one full slot of the main loop and admission of a
+// burst of starting stations
+// Build: cl /O2 bench_channel.c channel_core.c crc32c.c trace.c stats_shm.c frame_codec.c admission.c platform.c
+// Usage: bench_channel [frame_size] [max_stations]
+// Results go to stdout; the channel's own connection messages go to stderr.
+#define main channel_main
+#include "channel.c"
+#undef main
+#include "bench.h"
+#include "crc32c.h"
+
+#define BENCH_MAX_STATIONS 1024
+#define BROADCAST_SENDS 200000   // Frames sent per broadcast case, spread over the stations
+#define BROADCAST_BATCH 16       // Most broadcasts between drains of the stations' sockets
+#define QUEUED_BYTES 32768       // Bytes left queued per station between drains
+#define MAX_FRAME_BYTES QUEUED_BYTES
+#define SLOT_OPS 2000            // Slots run per slot case
+#define ENSURE_OPS 10000000
+#define GROW_STEP 4096           // Buffer growth per call in the grow case
+#define GROW_CALLS 16            // Calls per buffer reset in the grow case
+#define ADMIT_MIN_STATIONS 16    // Smallest startup burst
+#define ADMIT_MAX_STATIONS 256   // Largest startup burst (both ends of each pair are ours)
+#define ADMIT_TIMEOUT_MS 10000   // Gives up on a burst that is not admitted by then
+
+static SOCKET station_sockets[BENCH_MAX_STATIONS];   // Station end of each pair
+static ClientNode* station_nodes[BENCH_MAX_STATIONS];
+static int station_count = 0;
+static volatile int sink;    // Keeps results alive
+
+// Adds stations (loopback pairs registered through add_client) until there are n
+static bool grow_stations(SOCKET listener, const struct sockaddr_in* addr, int n) {
+	while (station_count < n) {
+		SOCKET channel_end, station_end;
+		struct sockaddr_in peer;
+
+		if (!bench_connect_pair(listener, addr, &channel_end, &station_end, &peer)) {
+			return false;
+		}
+		ClientNode* node = add_client(channel_end, peer);
+		if (!node) {
+			closesocket(channel_end);
+			closesocket(station_end);
+			return false;
+		}
+		station_sockets[station_count] = station_end;
+		station_nodes[station_count] = node;
+		station_count++;
+	}
+	return true;
+}
+
+static void drain_stations(void) {
+	for (int i = 0; i < station_count; i++) {
+		bench_drain(station_sockets[i]);
+	}
+}
+
+// Builds a data frame of frame_size bytes with a valid CRC-32C trailer
+static char* make_frame(int frame_size) {
+	char* frame = (char*)calloc(1, frame_size);
+	if (!frame) {
+		return NULL;
+	}
+
+	FrameHeader header;
+	memset(&header, 0, sizeof(header));
+	header.src_mac[0] = 0x02;
+	header.src_mac[5] = 0x01;
+	memset(header.dst_mac, 0xFF, 6);
+	header.type = FRAME_TYPE_DATA | FRAME_FLAG_CRC;
+	header.seq_num = 1;
+	header.length = (uint16_t)(frame_size - FRAME_HEADER_SIZE - CRC32C_SIZE);
+	frame_header_encode(&header, frame);
+	for (int i = FRAME_HEADER_SIZE; i < frame_size - CRC32C_SIZE; i++) {
+		frame[i] = (char)(i * 31);
+	}
+
+	wire_put_u32(frame + frame_size - CRC32C_SIZE, crc32c(0, frame, frame_size - CRC32C_SIZE));
+	return frame;
+}
+
+// ensure_buffer_capacity when the buffer is already large enough (every frame)
+static void bench_ensure_hit(void) {
+	ClientNode node;
+	node.info.buffer = (char*)malloc(INITIAL_BUFFER_SIZE);
+	node.info.buffer_size = INITIAL_BUFFER_SIZE;
+	if (!node.info.buffer) {
+		return;
+	}
+
+	double start = bench_now_ms();
+	for (int i = 0; i < ENSURE_OPS; i++) {
+		ensure_buffer_capacity(&node, 1024 + (i & 1023));
+		sink += node.info.buffer_size;
+	}
+	bench_report("ensure_buffer_capacity/hit", 1, bench_now_ms() - start, ENSURE_OPS, 1);
+	free(node.info.buffer);
+}
+
+// ensure_buffer_capacity when every call has to grow the buffer
+static void bench_ensure_grow(void) {
+	ClientNode node;
+	double elapsed = 0;
+	long long ops = 0;
+
+	for (int round = 0; round < ENSURE_OPS / 100 / GROW_CALLS; round++) {
+		node.info.buffer = (char*)malloc(INITIAL_BUFFER_SIZE);
+		node.info.buffer_size = INITIAL_BUFFER_SIZE;
+		if (!node.info.buffer) {
+			return;
+		}
+
+		double start = bench_now_ms();
+		for (int i = 1; i <= GROW_CALLS; i++) {
+			ensure_buffer_capacity(&node, INITIAL_BUFFER_SIZE + i * GROW_STEP);
+		}
+		elapsed += bench_now_ms() - start;
+		ops += GROW_CALLS;
+
+		sink += node.info.buffer_size;
+		free(node.info.buffer);
+	}
+	bench_report("ensure_buffer_capacity/grow", 1, elapsed, ops, 1);
+}
+
+// broadcast_to_all of one frame to every station
+static void bench_broadcast(char* frame, int frame_size) {
+	// Never queue more than the stations' socket buffers hold, or sends start failing
+	int batch = QUEUED_BYTES / frame_size;
+	if (batch > BROADCAST_BATCH) {
+		batch = BROADCAST_BATCH;
+	}
+	int batches = BROADCAST_SENDS / station_count / batch;
+	double elapsed = 0;
+	long long ops = 0;
+
+	if (batches < 4) {
+		batches = 4;
+	}
+	for (int b = 0; b < batches; b++) {
+		double start = bench_now_ms();
+		for (int i = 0; i < batch; i++) {
+			broadcast_to_all(frame, frame_size);
+		}
+		elapsed += bench_now_ms() - start;
+		ops += batch;
+		drain_stations();
+	}
+	bench_report("broadcast_to_all", station_count, elapsed, ops, station_count);
+}
+
+// One slot of the main loop in which one station sent a frame: poll, read, resolve
+// (CRC check included), broadcast and publish. The stations take turns sending.
+static void bench_slot(ChannelLoop* loop, char* frame, int frame_size) {
+	double elapsed = 0;
+	int delivered = 0;
+
+	for (int op = 0; op < SLOT_OPS; op++) {
+		int sender = op % station_count;
+		send(station_sockets[sender], frame, frame_size, 0);
+		bench_wait_readable(station_nodes[sender]->info.socket, frame_size);
+
+		double start = bench_now_ms();
+		int outcome = run_channel_slot(loop);
+		elapsed += bench_now_ms() - start;
+
+		delivered += (outcome == SLOT_DELIVERED);
+		drain_stations();
+	}
+	if (delivered != SLOT_OPS) {
+		fprintf(stderr, "run_channel_slot: %d of %d slots delivered their frame\n", delivered, SLOT_OPS);
+	}
+	bench_report("run_channel_slot", station_count, elapsed, SLOT_OPS, 1);
+}
+
+// Startup burst: n stations connect at once and the channel runs slots until all of them
+// are admitted. Reports the time from the first connect() to full admission (stations/s
+// in the frames/s column) and the number of slots it took.
+static void bench_admission(ChannelLoop* loop, const struct sockaddr_in* addr, int n) {
+	SOCKET* stations = (SOCKET*)malloc(n * sizeof(SOCKET));
+	int connecting = 0;
+	uint32_t first_slot = loop->slot;
+
+	if (!stations) {
+		return;
+	}
+	double start = bench_now_ms();
+	for (; connecting < n; connecting++) {
+		u_long mode = 1;
+		stations[connecting] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (stations[connecting] == INVALID_SOCKET) {
+			break;
+		}
+		ioctlsocket(stations[connecting], FIONBIO, &mode);
+		if (connect(stations[connecting], (const struct sockaddr*)addr, sizeof(*addr)) == SOCKET_ERROR &&
+			WSAGetLastError() != WSAEWOULDBLOCK && WSAGetLastError() != WSAEINPROGRESS) {
+			closesocket(stations[connecting]);
+			break;
+		}
+	}
+
+	double deadline = start + ADMIT_TIMEOUT_MS;
+	while (client_count < connecting && bench_now_ms() < deadline) {
+		run_channel_slot(loop);
+	}
+	double elapsed = bench_now_ms() - start;
+
+	if (client_count < n) {
+		fprintf(stderr, "admit_stations: %d of %d stations admitted\n", client_count, n);
+	}
+	bench_report("admit_stations/burst", n, elapsed, 1, client_count);
+	bench_report_count("admit_stations/slots", n, loop->slot - first_slot);
+
+	cleanup_clients();
+	for (int i = 0; i < connecting; i++) {
+		closesocket(stations[i]);
+	}
+	free(stations);
+}
+
+int main(int argc, char* argv[]) {
+	int frame_size = (argc > 1) ? atoi(argv[1]) : 1024;
+	int max_stations = (argc > 2) ? atoi(argv[2]) : BENCH_MAX_STATIONS;
+
+	if (frame_size < FRAME_HEADER_SIZE + CRC32C_SIZE || frame_size > MAX_FRAME_BYTES ||
+		max_stations < 1 || max_stations > BENCH_MAX_STATIONS) {
+		fprintf(stderr, "Usage: %s [frame_size (%d..%d)] [max_stations (1..%d)]\n", argv[0],
+			FRAME_HEADER_SIZE + CRC32C_SIZE, MAX_FRAME_BYTES, BENCH_MAX_STATIONS);
+		return 1;
+	}
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		fprintf(stderr, "Error at WSAStartup()\n");
+		return 1;
+	}
+
+	struct sockaddr_in addr;
+	SOCKET listener = bench_listen(&addr);
+	char* frame = make_frame(frame_size);
+	char* noise_buffer = create_noise_frame();
+	if (listener == INVALID_SOCKET || !frame || !noise_buffer) {
+		return 1;
+	}
+
+	// Publish statistics like the channel does by default
+	StatsShm stats_shm = { 0 };
+	if (stats_create(&stats_shm, ntohs(addr.sin_port), 0)) {
+		live_stats = stats_shm.segment;
+	}
+
+	ChannelLoop loop;
+	loop.listen_sockets[0] = listener;
+	loop.listen_count = 1;
+	loop.slot_time_ms = 0;       // Poll: the frame is already waiting when the slot starts
+	loop.noise_buffer = noise_buffer;
+	loop.trace = NULL;
+	loop.slot = 0;
+	memset(&loop.link, 0, sizeof(loop.link));    // No link model: frames take no time on the medium
+	loop.poll_fds = NULL;
+	loop.poll_capacity = 0;
+
+	bench_print_header("bench_channel", frame_size);
+	bench_ensure_hit();
+	bench_ensure_grow();
+
+	for (int n = 1; n <= max_stations; n *= 2) {
+		if (!grow_stations(listener, &addr, n)) {
+			break;
+		}
+		bench_broadcast(frame, frame_size);
+		bench_slot(&loop, frame, frame_size);
+	}
+
+	// The startup bursts run on their own, after the fan-out stations are gone
+	cleanup_clients();
+	for (int i = 0; i < station_count; i++) {
+		closesocket(station_sockets[i]);
+	}
+	station_count = 0;
+	// accept_stations() drains the queue until accept() would block, as on the
+	// channel's own listener
+	u_long mode = 1;
+	ioctlsocket(listener, FIONBIO, &mode);
+	for (int n = ADMIT_MIN_STATIONS; n <= ADMIT_MAX_STATIONS && n <= max_stations; n *= 4) {
+		bench_admission(&loop, &addr, n);
+	}
+
+	if (live_stats) {
+		live_stats = NULL;
+		stats_close(&stats_shm);
+	}
+	free(loop.poll_fds);
+	free(noise_buffer);
+	free(frame);
+	closesocket(listener);
+	WSACleanup();
+	return 0;
+}
@@ -0,0 +1,193 @@
+// bench_fec.c - FEC benchmarks: codec throughput, and completion time vs overhead of
+// plain retransmission against k+m frame groups at several collision rates.
+// Build: cl /O2 bench_fec.c fec.c platform.c
+// Usage: bench_fec [frames] [runs] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "fec.h"
+
+#define MAX_ATTEMPTS 10          // Same limit as the sender
+#define SHARD_LEN 1024           // Bytes per shard in the throughput test
+#define CODEC_ROUNDS 2000
+
+// FEC configurations compared against plain retransmission (k = 0)
+static const int configs[][2] = { { 0, 0 }, { 4, 1 }, { 8, 1 }, { 8, 2 }, { 16, 2 }, { 16, 4 }, { 32, 4 } };
+static const double collision_rates[] = { 0.05, 0.1, 0.2, 0.3 };
+
+static uint32_t rand_state;
+
+// Same generator as the sender's station_rand
+static int bench_rand(void) {
+	rand_state = rand_state * 214013u + 2531011u;
+	return (int)((rand_state >> 16) & 0x7FFF);
+}
+
+static bool collides(double rate) {
+	return bench_rand() < (int)(rate * 32768.0);
+}
+
+// Slots spent backing off after the given attempt, same rule as station_backoff
+static int backoff_slots(int attempt) {
+	return bench_rand() % (1 << attempt);
+}
+
+// Simulates one transfer of `frames` frames where every transmission collides with
+// probability `rate`. Each transmission takes one slot. Groups follow the sender: a
+// lost shard is dropped while the shards still to come can make up for it, otherwise
+// it is retried. Returns the slots taken (-1 if a frame hit MAX_ATTEMPTS) and adds the
+// number of transmissions to *transmissions.
+static long long simulate(int frames, int k, int m, double rate, long long* transmissions) {
+	long long slots = 0;
+
+	if (k == 0) {
+		k = 1;  // Plain retransmission = groups of one frame without parity
+		m = 0;
+	}
+
+	for (int first = 0; first < frames; first += k) {
+		int needed = (frames - first < k) ? frames - first : k;
+		int untaken = needed + m;
+		int delivered = 0;
+
+		while (delivered < needed) {
+			untaken--;
+			for (int attempt = 1;; attempt++) {
+				slots++;
+				(*transmissions)++;
+				if (!collides(rate)) {
+					delivered++;
+					break;
+				}
+				bool abandon = (m > 0 && delivered + untaken >= needed);
+				if (!abandon && attempt >= MAX_ATTEMPTS) {
+					return -1;
+				}
+				slots += backoff_slots(attempt);
+				if (abandon) {
+					break;
+				}
+			}
+		}
+	}
+
+	return slots;
+}
+
+static int compare_ll(const void* a, const void* b) {
+	long long x = *(const long long*)a;
+	long long y = *(const long long*)b;
+	return (x > y) - (x < y);
+}
+
+// Measures encode and reconstruct throughput for a k+m group
+static void bench_codec(int k, int m) {
+	static uint8_t buffers[FEC_MAX_SHARDS][SHARD_LEN];
+	uint8_t* shards[FEC_MAX_SHARDS];
+	bool present[FEC_MAX_SHARDS];
+
+	for (int i = 0; i < k + m; i++) {
+		shards[i] = buffers[i];
+		for (int n = 0; n < SHARD_LEN; n++) {
+			buffers[i][n] = (uint8_t)bench_rand();
+		}
+	}
+
+	double start = now_ms();
+	for (int r = 0; r < CODEC_ROUNDS; r++) {
+		for (int j = 0; j < m; j++) {
+			fec_encode_parity(k, j, (const uint8_t* const*)shards, shards[k + j], SHARD_LEN);
+		}
+	}
+	double encode_ms = now_ms() - start;
+
+	// Worst case: as many data shards lost as there are parity shards
+	for (int i = 0; i < k + m; i++) {
+		present[i] = (i >= m);
+	}
+	start = now_ms();
+	for (int r = 0; r < CODEC_ROUNDS; r++) {
+		if (fec_reconstruct(k, m, shards, present, SHARD_LEN) != m) {
+			fprintf(stderr, "Reconstruction failed for k=%d m=%d\n", k, m);
+			return;
+		}
+	}
+	double decode_ms = now_ms() - start;
+
+	double data_mb = (double)CODEC_ROUNDS * k * SHARD_LEN / 1000000.0;
+	printf("  k=%-2d m=%d  encode %8.1f MB/s   reconstruct (%d lost) %8.1f MB/s\n",
+		k, m, data_mb / (encode_ms / 1000.0), m, data_mb / (decode_ms / 1000.0));
+}
+
+int main(int argc, char* argv[]) {
+	int frames = (argc > 1) ? atoi(argv[1]) : 1000;
+	int runs = (argc > 2) ? atoi(argv[2]) : 200;
+	rand_state = (argc > 3) ? (uint32_t)atoi(argv[3]) : 1;
+
+	if (frames < 1 || runs < 1) {
+		fprintf(stderr, "Usage: %s [frames] [runs] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	long long* results = (long long*)malloc(runs * sizeof(long long));
+	if (!results) {
+		fprintf(stderr, "Memory allocation failed\n");
+		return 1;
+	}
+
+	printf("Codec throughput (%d byte shards):\n", SHARD_LEN);
+	for (int c = 1; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+		bench_codec(configs[c][0], configs[c][1]);
+	}
+
+	printf("\nCompletion time, %d frames, %d runs per point (slots, 1 slot per transmission):\n", frames, runs);
+	printf("%-10s %-8s %10s %10s %10s %10s %8s\n",
+		"collision", "scheme", "mean", "p50", "p99", "tx/frame", "failed");
+	for (int r = 0; r < (int)(sizeof(collision_rates) / sizeof(collision_rates[0])); r++) {
+		double rate = collision_rates[r];
+
+		for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+			int k = configs[c][0];
+			int m = configs[c][1];
+			long long transmissions = 0;
+			int completed = 0;
+			int failed = 0;
+			double total = 0;
+
+			for (int run = 0; run < runs; run++) {
+				long long slots = simulate(frames, k, m, rate, &transmissions);
+				if (slots < 0) {
+					failed++;
+					continue;
+				}
+				results[completed++] = slots;
+				total += slots;
+			}
+
+			char scheme[16];
+			if (k == 0) {
+				snprintf(scheme, sizeof(scheme), "retx");
+			}
+			else {
+				snprintf(scheme, sizeof(scheme), "%d+%d", k, m);
+			}
+
+			if (completed == 0) {
+				printf("%-10.2f %-8s %10s %10s %10s %10.3f %8d\n", rate, scheme, "-", "-", "-",
+					(double)transmissions / ((double)frames * runs), failed);
+				continue;
+			}
+			qsort(results, completed, sizeof(long long), compare_ll);
+			printf("%-10.2f %-8s %10.1f %10lld %10lld %10.3f %8d\n", rate, scheme,
+				total / completed, results[completed / 2], results[(completed * 99) / 100],
+				(double)transmissions / ((double)frames * runs), failed);
+		}
+		printf("\n");
+	}
+
+	free(results);
+	return 0;
+}
@@ -0,0 +1,197 @@
+// bench_link.c - frame size and backoff slot time for a link: simulates stations sending
+// a file each through the channel's link model (-link-rate, -prop-delay) with the
+// sender's backoff, and reports the goodput of every combination and the best one.
+// Build: cl /O2 bench_link.c
+// Usage: bench_link <link_mbps> <prop_delay_us> [stations] [file_kb] [runs] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "frame_codec.h"
+#include "crc32c.h"
+
+#define MAX_ATTEMPTS 10          // Same limit as the sender
+#define MAX_STATIONS 256
+
+static const int frame_sizes[] = { 64, 128, 256, 512, 1024, 1500, 4096, 9000, 16384, 65535 };
+static const int slot_times_ms[] = { 1, 2, 5, 10, 20, 50 };
+
+typedef struct {
+	double ready_at;         // When the station sends its next transmission
+	int frames_left;
+	int attempt;             // Transmissions of the current frame so far
+	bool on_medium;
+} SimStation;
+
+static uint32_t rand_state;
+
+// Same generator as the sender's station_rand
+static int bench_rand(void) {
+	rand_state = rand_state * 214013u + 2531011u;
+	return (int)((rand_state >> 16) & 0x7FFF);
+}
+
+// Simulates one run. All stations start at once and send frames of airtime_ms each.
+// The earliest transmission opens a busy period on the medium, and every transmission
+// that starts before the medium is quiet again joins it - the channel's rule. A lone
+// frame is delivered and its sender goes on with the next one when the echo arrives at
+// the end of the period. Otherwise every sender backs off rand % 2^attempt slots, as in
+// station_backoff. Returns the time the last station finished (-1 if a frame hit
+// MAX_ATTEMPTS) and adds the number of transmissions to *transmissions.
+static double simulate(SimStation* stations, int count, int frames, double airtime_ms,
+	int slot_time_ms, long long* transmissions) {
+	double finish = 0;
+	int active = count;
+
+	for (int i = 0; i < count; i++) {
+		stations[i].ready_at = 0;
+		stations[i].frames_left = frames;
+		stations[i].attempt = 0;
+	}
+
+	while (active > 0) {
+		int first = -1;
+		for (int i = 0; i < count; i++) {
+			stations[i].on_medium = false;
+			if (stations[i].frames_left > 0 && (first < 0 || stations[i].ready_at < stations[first].ready_at)) {
+				first = i;
+			}
+		}
+
+		double busy_until = stations[first].ready_at + airtime_ms;
+		int senders = 1;
+		stations[first].on_medium = true;
+		for (bool joined = true; joined;) {
+			joined = false;
+			for (int i = 0; i < count; i++) {
+				SimStation* st = &stations[i];
+				if (st->frames_left > 0 && !st->on_medium && st->ready_at < busy_until) {
+					st->on_medium = true;
+					senders++;
+					joined = true;
+					if (st->ready_at + airtime_ms > busy_until) {
+						busy_until = st->ready_at + airtime_ms;
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < count; i++) {
+			SimStation* st = &stations[i];
+			if (!st->on_medium) {
+				continue;
+			}
+			st->attempt++;
+			(*transmissions)++;
+			if (senders == 1) {
+				st->attempt = 0;
+				st->ready_at = busy_until;
+				if (--st->frames_left == 0) {
+					active--;
+					finish = busy_until;
+				}
+			}
+			else {
+				if (st->attempt >= MAX_ATTEMPTS) {
+					return -1;
+				}
+				st->ready_at = busy_until + (double)(bench_rand() % (1 << st->attempt)) * slot_time_ms;
+			}
+		}
+	}
+
+	return finish;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <link_mbps> <prop_delay_us> [stations] [file_kb] [runs] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	double link_mbps = atof(argv[1]);
+	double prop_us = atof(argv[2]);
+	int station_count = (argc > 3) ? atoi(argv[3]) : 4;
+	int file_kb = (argc > 4) ? atoi(argv[4]) : 64;
+	int runs = (argc > 5) ? atoi(argv[5]) : 20;
+	rand_state = (argc > 6) ? (uint32_t)atoi(argv[6]) : 1;
+
+	if (link_mbps <= 0 || prop_us < 0 || station_count < 1 || station_count > MAX_STATIONS ||
+		file_kb < 1 || runs < 1) {
+		fprintf(stderr, "Link rate must be positive, 1-%d stations, file and runs at least 1\n", MAX_STATIONS);
+		return 1;
+	}
+
+	SimStation* stations = (SimStation*)malloc(station_count * sizeof(SimStation));
+	if (!stations) {
+		fprintf(stderr, "Memory allocation failed\n");
+		return 1;
+	}
+
+	int64_t file_bytes = (int64_t)file_kb * 1024;
+	printf("# bench_link link=%.3f Mbps prop_delay=%.1f us stations=%d file=%d KB runs=%d\n",
+		link_mbps, prop_us, station_count, file_kb, runs);
+	printf("# Frames carry a %d byte header and a %d byte CRC trailer; goodput counts file bytes only\n",
+		FRAME_HEADER_SIZE, CRC32C_SIZE);
+	printf("%-8s %8s %12s %14s %14s %10s %8s\n",
+		"frame", "slot_ms", "airtime_us", "goodput_mbps", "completion_ms", "tx/frame", "failed");
+
+	double best_goodput = 0;
+	int best_frame = 0;
+	int best_slot = 0;
+	for (int f = 0; f < (int)(sizeof(frame_sizes) / sizeof(frame_sizes[0])); f++) {
+		int frame_size = frame_sizes[f];
+		int payload = frame_size - FRAME_HEADER_SIZE - CRC32C_SIZE;
+		int frames = (int)((file_bytes + payload - 1) / payload);
+		double airtime_ms = frame_size * 8.0 / (link_mbps * 1000.0) + prop_us / 1000.0;
+
+		for (int s = 0; s < (int)(sizeof(slot_times_ms) / sizeof(slot_times_ms[0])); s++) {
+			int slot_time_ms = slot_times_ms[s];
+			long long transmissions = 0;
+			int completed = 0;
+			int failed = 0;
+			double total_ms = 0;
+
+			for (int run = 0; run < runs; run++) {
+				double finish = simulate(stations, station_count, frames, airtime_ms, slot_time_ms, &transmissions);
+				if (finish < 0) {
+					failed++;
+					continue;
+				}
+				completed++;
+				total_ms += finish;
+			}
+
+			double tx_per_frame = (double)transmissions / ((double)frames * station_count * runs);
+			if (completed == 0) {
+				printf("%-8d %8d %12.1f %14s %14s %10.3f %8d\n", frame_size, slot_time_ms,
+					airtime_ms * 1000.0, "-", "-", tx_per_frame, failed);
+				continue;
+			}
+
+			double mean_ms = total_ms / completed;
+			double goodput = (double)file_bytes * station_count * 8.0 / (mean_ms * 1000.0);
+			printf("%-8d %8d %12.1f %14.3f %14.1f %10.3f %8d\n", frame_size, slot_time_ms,
+				airtime_ms * 1000.0, goodput, mean_ms, tx_per_frame, failed);
+
+			// A combination where a transfer can fail is never the best one
+			if (failed == 0 && goodput > best_goodput) {
+				best_goodput = goodput;
+				best_frame = frame_size;
+				best_slot = slot_time_ms;
+			}
+		}
+	}
+
+	if (best_frame > 0) {
+		printf("# Best: frame size %d, slot time %d ms: %.3f Mbps (%.1f%% of the link)\n",
+			best_frame, best_slot, best_goodput, 100.0 * best_goodput / link_mbps);
+	}
+	else {
+		printf("# Best: none - every combination had failed transfers\n");
+	}
+
+	free(stations);
+	return 0;
+}
@@ -0,0 +1,288 @@
+// bench_server.c - microbenchmarks of the sender's hot paths: echo matching, receiving
+// from the channel (loopback pair) and building frames from a file (in the OS cache)
+// Build: cl /O2 bench_server.c lz.c fec.c crc32c.c frame_codec.c platform.c
+// Usage: bench_server [frame_size]
+#define main server_main
+#include "server.c"
+#undef main
+#include "bench.h"
+
+#define MATCH_OPS 20000000
+#define RECEIVE_OPS 20000
+#define RECEIVE_QUEUED_BYTES 32768 // Most bytes queued for one station_receive call
+#define BUILD_OPS 100000         // Frames built per build case
+#define BUILD_FILE_BYTES (4 << 20)
+
+static volatile int sink;    // Keeps results alive
+
+// Encodes a header as build_frame does. `station` is the last byte of the source MAC.
+static void make_header(char* wire, uint8_t station, uint32_t seq_num, uint16_t length) {
+	static const uint8_t src_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	static const uint8_t dst_mac[6] = { 0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x00 };
+	FrameHeader header;
+
+	memcpy(header.src_mac, src_mac, 6);
+	header.src_mac[5] = station;
+	memcpy(header.dst_mac, dst_mac, 6);
+	header.type = FRAME_TYPE_DATA | FRAME_FLAG_CRC;
+	header.seq_num = seq_num;
+	header.length = length;
+	frame_header_encode(&header, wire);
+}
+
+// frame_echo_matches of the frame in flight against a received header
+static void bench_match(const char* name, const char* received) {
+	char sent[FRAME_HEADER_SIZE];
+	char copies[64][FRAME_HEADER_SIZE];    // Rotated through so the compiler cannot hoist the call
+	FrameEchoKey key;
+	int matches = 0;
+
+	make_header(sent, 0x01, 1000, 1000);
+	frame_echo_key(sent, &key);
+	for (int i = 0; i < 64; i++) {
+		memcpy(copies[i], received, FRAME_HEADER_SIZE);
+	}
+
+	double start = bench_now_ms();
+	for (int i = 0; i < MATCH_OPS; i++) {
+		matches += frame_echo_matches(&key, copies[i & 63]);
+	}
+	double elapsed = bench_now_ms() - start;
+
+	sink += matches;
+	bench_report(name, 1, elapsed, MATCH_OPS, 1);
+}
+
+// Walking a read frame by frame, as station_receive does, when it holds `before` bytes
+// of other traffic ahead of our echo
+static void bench_walk(const char* name, int frame_size, int before) {
+	uint16_t length = (uint16_t)(frame_size - FRAME_HEADER_SIZE - CRC32C_SIZE);
+	char* buffer = (char*)calloc(1, before + frame_size);
+	FrameEchoKey key;
+	int found = 0;
+
+	if (!buffer) {
+		return;
+	}
+	for (int offset = 0; offset + FRAME_HEADER_SIZE <= before; offset += frame_size) {
+		make_header(buffer + offset, 0x02, 77, length);
+	}
+	make_header(buffer + before, 0x01, 1000, length);
+	frame_echo_key(buffer + before, &key);
+
+	int ops = MATCH_OPS / 10;
+	double start = bench_now_ms();
+	for (int i = 0; i < ops; i++) {
+		const char* frame = buffer;
+		int available = before + frame_size;
+		while (available >= FRAME_HEADER_SIZE) {
+			int frame_len = frame_wire_size(frame);
+			if (frame_len > available) {
+				break;
+			}
+			found += frame_echo_matches(&key, frame);
+			frame += frame_len;
+			available -= frame_len;
+		}
+	}
+	double elapsed = bench_now_ms() - start;
+
+	sink += found;
+	bench_report(name, 1, elapsed, ops, 1);
+	free(buffer);
+}
+
+// station_receive of another station's traffic, `frames` frames queued on the socket per
+// call. With `split`, each call also gets half of the next frame, so every read ends in a
+// partial frame that is carried over and completed by the next one.
+static void bench_receive(const char* name, SOCKET channel_end, SOCKET station_end, int frame_size,
+	int frames, bool split) {
+	uint16_t length = (uint16_t)(frame_size - FRAME_HEADER_SIZE - CRC32C_SIZE);
+	int chunk = frames * frame_size + (split ? frame_size / 2 : 0);
+	char* stream = (char*)calloc(frames + 2, frame_size);    // The frame repeated
+	Station st;
+	double elapsed = 0;
+
+	memset(&st, 0, sizeof(st));
+	st.socket = station_end;
+	st.state = STATION_IDLE;
+	st.recv_buffer_size = FRAME_MAX_WIRE_SIZE + MIN_RECV_BUFFER_SIZE;
+	st.recv_buffer = (char*)malloc(st.recv_buffer_size);
+	st.decode_buffer = (char*)malloc(MAX_PAYLOAD_SIZE);
+	if (!stream || !st.recv_buffer || !st.decode_buffer) {
+		free(stream);
+		free(st.recv_buffer);
+		free(st.decode_buffer);
+		return;
+	}
+	for (int i = 0; i < frames + 2; i++) {
+		char* frame = stream + i * frame_size;
+		make_header(frame, 0x02, 77, length);
+		wire_put_u32(frame + frame_size - CRC32C_SIZE, crc32c(0, frame, frame_size - CRC32C_SIZE));
+	}
+
+	int64_t position = 0;    // Stream bytes sent so far
+	for (int op = 0; op < RECEIVE_OPS; op++) {
+		send(channel_end, stream + position % frame_size, chunk, 0);
+		position += chunk;
+		bench_wait_readable(station_end, chunk);
+
+		double start = bench_now_ms();
+		station_receive(&st);
+		elapsed += bench_now_ms() - start;
+	}
+	bench_drain(station_end);
+
+	sink += st.received_frames;
+	bench_report(name, frames, elapsed, RECEIVE_OPS, (double)chunk / frame_size);
+	free(st.rx_partial);
+	free(st.recv_buffer);
+	free(st.decode_buffer);
+	free(stream);
+}
+
+// Writes a text file that compresses about as well as a log
+static FILE* make_file(void) {
+	FILE* fp = tmpfile();
+	int written = 0;
+
+	if (!fp) {
+		fprintf(stderr, "Cannot create temporary file\n");
+		return NULL;
+	}
+	for (int line = 0; written < BUILD_FILE_BYTES; line++) {
+		written += fprintf(fp, "2025-03-%02d 12:%02d:%02d,station-%03d,seq=%d,value=%d,status=OK\n",
+			1 + line % 28, (line / 60) % 60, line % 60, line % 97, line, (line * 7919) % 100000);
+	}
+	fflush(fp);
+	return fp;
+}
+
+// The sender's per-frame build path, as the read-ahead thread runs it: read the
+// payload from the file, compress and/or FEC-stage it, build parity frames when a
+// group is complete, and append the CRC trailer
+static void bench_build(const char* name, FILE* fp, int frame_size, bool crc, bool compress, int fec_k, int fec_m) {
+	uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	FrameRing ring;
+	ReadyFrame* slot;
+
+	// Payload per frame, as the sender's main() works it out
+	int payload_size = frame_size - FRAME_HEADER_SIZE - (crc ? CRC32C_SIZE : 0);
+	if (fec_k > 0) {
+		payload_size -= FEC_HEADER_SIZE + FEC_SHARD_PREFIX_SIZE;
+	}
+	if (payload_size <= 0) {
+		return;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	int file_size = (int)ftell(fp);
+	int total_frames = (file_size + payload_size - 1) / payload_size;
+	rewind(fp);
+
+	if (!ring_init(&ring, fp, 1, total_frames, file_size, frame_size, payload_size, mac, mac)) {
+		return;
+	}
+	ring.compress = compress;
+	ring.crc = crc;
+	char* scratch = (char*)malloc(ring.buffer_size);
+	if (!scratch || (fec_k > 0 && !ring_enable_fec(&ring, fec_k, fec_m))) {
+		free(scratch);
+		ring_free(&ring);
+		return;
+	}
+	slot = &ring.slots[0];
+
+	int64_t wire_bytes = 0;
+	double start = bench_now_ms();
+	for (int op = 0; op < BUILD_OPS; op++) {
+		if (!ring_has_work(&ring)) {
+			rewind(fp);    // Start the file over
+			ring.next_frame = 0;
+		}
+
+		bool ok = true;
+		if (ring.fec_parity_next >= 0) {
+			build_parity_frame(&ring, slot);
+		}
+		else {
+			ok = build_frame(&ring, slot, ring.next_frame, scratch);
+			ring.next_frame++;
+		}
+		if (!ok) {
+			break;
+		}
+		if (ring.crc) {
+			frame_add_crc(slot);
+		}
+		frame_echo_key(slot->data, &slot->echo);
+		wire_bytes += slot->wire_len;
+	}
+	double elapsed = bench_now_ms() - start;
+
+	sink += (int)wire_bytes;
+	bench_report(name, 1, elapsed, BUILD_OPS, 1);
+	free(scratch);
+	ring_free(&ring);
+}
+
+int main(int argc, char* argv[]) {
+	int frame_size = (argc > 1) ? atoi(argv[1]) : 1024;
+
+	if (frame_size < 64 || frame_size > MAX_PAYLOAD_SIZE) {
+		fprintf(stderr, "Usage: %s [frame_size (64..%d)]\n", argv[0], MAX_PAYLOAD_SIZE);
+		return 1;
+	}
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		fprintf(stderr, "Error at WSAStartup()\n");
+		return 1;
+	}
+
+	bench_print_header("bench_server", frame_size);
+
+	// Echo matching: the echo itself, another station's frame, another frame of ours
+	char received[FRAME_HEADER_SIZE];
+	make_header(received, 0x01, 1000, 1000);
+	bench_match("frame_echo_matches/match", received);
+	make_header(received, 0x02, 1000, 1000);
+	bench_match("frame_echo_matches/other_station", received);
+	make_header(received, 0x01, 999, 1000);
+	bench_match("frame_echo_matches/other_seq", received);
+
+	bench_walk("frame_walk/echo_first", frame_size, 0);
+	bench_walk("frame_walk/echo_after_frame", frame_size, frame_size);
+
+	struct sockaddr_in addr;
+	struct sockaddr_in peer;
+	SOCKET channel_end, station_end;
+	SOCKET listener = bench_listen(&addr);
+	if (listener == INVALID_SOCKET ||
+		!bench_connect_pair(listener, &addr, &channel_end, &station_end, &peer)) {
+		return 1;
+	}
+	// Up to 16 frames queued, as long as they fit in the socket buffer
+	int queued = RECEIVE_QUEUED_BYTES / frame_size - 1;
+	queued = (queued < 16) ? queued : 16;
+	bench_receive("station_receive/whole_frames", channel_end, station_end, frame_size, 1, false);
+	bench_receive("station_receive/whole_frames", channel_end, station_end, frame_size, queued, false);
+	bench_receive("station_receive/carry_over", channel_end, station_end, frame_size, 1, true);
+	bench_receive("station_receive/carry_over", channel_end, station_end, frame_size, queued, true);
+	closesocket(channel_end);
+	closesocket(station_end);
+	closesocket(listener);
+
+	FILE* fp = make_file();
+	if (!fp) {
+		return 1;
+	}
+	bench_build("build_frame/plain", fp, frame_size, false, false, 0, 0);
+	bench_build("build_frame/crc", fp, frame_size, true, false, 0, 0);
+	bench_build("build_frame/compress+crc", fp, frame_size, true, true, 0, 0);
+	bench_build("build_frame/fec8+2+crc", fp, frame_size, true, false, 8, 2);
+	fclose(fp);
+
+	WSACleanup();
+	return 0;
+}
@@ -1,45 +1,45 @@
 ﻿//channel.c
-#define _WINSOCK_DEPRECATED_NO_WARNINGS
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <winsock2.h>
-#include <windows.h>
 #include <time.h>
 #include <stdbool.h>
-#include <conio.h>  // For _kbhit() and _getch() functions
-
-#pragma comment(lib, "Ws2_32.lib")
+#include "platform.h"
+#include "channel_core.h"
+#include "trace.h"
+#include "stats_shm.h"
+#include "frame_codec.h"
+#include "admission.h"
 
 // No hard limit on frame size - will be determined by what servers send
 #define INITIAL_BUFFER_SIZE 4096  // Initial buffer size, will grow as needed
-#define FRAME_TYPE_DATA 0
-#define FRAME_TYPE_NOISE 2
-
-#pragma pack(push, 1)
-typedef struct {
-	uint8_t src_mac[6];
-	uint8_t dst_mac[6];
-	uint16_t type;      // 0 = DATA, 2 = NOISE
-	uint32_t seq_num;
-	uint16_t length;
-} FrameHeader;
-#pragma pack(pop)
+#define DEFAULT_BACKLOG 1024      // Pending connections per listening socket (the system may cap it)
+#define MAX_ACCEPTORS 8           // Listening sockets sharing the port (-acceptors)
+#define MAX_QUEUED_BYTES (4 << 20) // Unsent bytes a station may fall behind by before it is dropped
 
 typedef struct {
 	SOCKET socket;
 	struct sockaddr_in addr;
 	int total_frames;
 	int collision_count;
-	clock_t first_frame_time;
-	clock_t last_frame_time;
+	int corrupt_frames;     // Frames that failed the CRC-32C check
+	int deferred_frames;    // Frames turned away over the rate limit, not counted in total_frames
+	TokenBucket bucket;     // Per-station rate limit (-rate)
+	double first_frame_time;  // now_ms() of the first and the latest frame, 0 before any
+	double last_frame_time;
 	int64_t total_bytes;
 	bool active;
 	bool connected;         // Whether the client is currently connected
-	char* buffer;           // Dynamically sized buffer
+	char* buffer;           // Bytes received, starting at the station's next frame
 	int buffer_size;        // Current size of the buffer
-	int frame_length;       // Length of current frame in buffer
+	int buffer_len;         // Bytes in buffer, possibly several frames or part of one
+	char* out_buffer;       // Bytes the socket has not taken yet, sent as it drains
+	int out_capacity;
+	int out_len;
+	int out_offset;         // Bytes of out_buffer already sent
+	int poll_index;         // Entry in the slot's poll set, -1 if accepted after the wait
+	StatsStation* stats;    // Live counters in the statistics segment, NULL if not published
 } ClientInfo;
 
 // Linked list node for client management
@@ -48,13 +48,40 @@ typedef struct ClientNode {
 	struct ClientNode* next;
 } ClientNode;
 
+// State of the channel main loop
+typedef struct {
+	SOCKET listen_sockets[MAX_ACCEPTORS];
+	int listen_count;       // Listening sockets in use, each with its own accept queue
+	int slot_time_ms;
+	char* noise_buffer;
+	Trace* trace;           // NULL when not tracing
+	uint32_t slot;          // Slots run so far
+	LinkModel link;
+	PlatformPollFd* poll_fds;   // Listening sockets, then the active clients
+	int poll_capacity;
+} ChannelLoop;
+
 // Global linked list head
 static ClientNode* client_list = NULL;
 static int client_count = 0;
 
+// Shared statistics segment, NULL when disabled
+static StatsSegment* live_stats = NULL;
+
+// Rate limits: every station (-rate) and single source MACs (-mac-rate)
+static double station_rate = 0;
+static double station_burst = 1;
+static MacLimit mac_limits[MAX_MAC_LIMITS];
+static int mac_limit_count = 0;
+
 // Forward declarations of functions
-SOCKET create_listening_socket(int port);
+SOCKET create_listening_socket(int port, int backlog, bool reuse_port);
+int accept_stations(SOCKET listen_socket);
+void close_listening_sockets(ChannelLoop* loop);
 void ensure_buffer_capacity(ClientNode* client, int required_size);
+bool client_receive(ClientNode* client);
+int client_next_frame(ClientNode* client);
+void client_take_frame(ClientNode* client, int length);
 void mark_client_disconnected(ClientNode* client);
 ClientNode* add_client(SOCKET socket, struct sockaddr_in addr);
 ClientNode* find_client_by_socket(SOCKET socket);
@@ -63,24 +90,25 @@ char* create_noise_frame(void);
 void broadcast_noise_frame(char* noise_buffer);
 bool check_for_exit(void);
 void broadcast_to_all(char* buffer, int length);
-double calculate_bandwidth(int64_t bytes, clock_t start_time, clock_t end_time);
+bool client_send(ClientNode* client, const char* data, int length);
+bool client_flush(ClientNode* client);
+int admit_frame(ClientNode* client, const char* frame, double now);
+void send_deferral(ClientNode* client, const char* frame, int retry_after_ms);
+void trace_slot(Trace* trace, uint32_t slot, const LinkModel* link, double now, int outcome,
+	ReceivedFrame* frames, int frame_count);
+void publish_slot_stats(StatsSegment* segment, uint32_t slot, int outcome, ReceivedFrame* frames, int frame_count);
+double calculate_bandwidth(int64_t bytes, double start_ms, double end_ms);
 void print_all_statistics(void);
+void print_link_statistics(const LinkModel* link);
+int run_channel_slot(ChannelLoop* loop);
 
-// Function to initialize Winsock and create a listening socket
-SOCKET create_listening_socket(int port) {
-	// Initialize Winsock
-	WSADATA wsaData;
-	int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-	if (iResult != 0) {
-		fprintf(stderr, "Error at WSAStartup(): %d\n", iResult);
-		return INVALID_SOCKET;
-	}
-
+// Function to create a listening socket. With reuse_port, several sockets can listen on
+// the same port and the system spreads incoming connections over their accept queues.
+SOCKET create_listening_socket(int port, int backlog, bool reuse_port) {
 	// Create listening socket
 	SOCKET tcp_s = socket(AF_INET, SOCK_STREAM, 0);
 	if (tcp_s == INVALID_SOCKET) {
-		fprintf(stderr, "Error at socket(): %ld\n", WSAGetLastError());
-		WSACleanup();
+		fprintf(stderr, "Error at socket(): %d\n", WSAGetLastError());
 		return INVALID_SOCKET;
 	}
 
@@ -88,6 +116,19 @@ SOCKET create_listening_socket(int port) {
 	u_long mode = 1;
 	ioctlsocket(tcp_s, FIONBIO, &mode);
 
+#ifdef SO_REUSEPORT
+	if (reuse_port) {
+		int enable = 1;
+		if (setsockopt(tcp_s, SOL_SOCKET, SO_REUSEPORT, (const char*)&enable, sizeof(enable)) == SOCKET_ERROR) {
+			fprintf(stderr, "setsockopt(SO_REUSEPORT) failed: %d\n", WSAGetLastError());
+			closesocket(tcp_s);
+			return INVALID_SOCKET;
+		}
+	}
+#else
+	(void)reuse_port;
+#endif
+
 	// Bind socket to port
 	struct sockaddr_in my_addr;
 	my_addr.sin_family = AF_INET;
@@ -96,24 +137,70 @@ SOCKET create_listening_socket(int port) {
 
 	int status = bind(tcp_s, (struct sockaddr*)&my_addr, sizeof(my_addr));
 	if (status == SOCKET_ERROR) {
-		fprintf(stderr, "bind() failed: %ld\n", WSAGetLastError());
+		fprintf(stderr, "bind() failed: %d\n", WSAGetLastError());
 		closesocket(tcp_s);
-		WSACleanup();
 		return INVALID_SOCKET;
 	}
 
-	// Start listening
-	status = listen(tcp_s, 10); // Allow up to 10 pending connections
+	// Start listening. A station that finds the queue full has to wait for a connect
+	// retry, so the backlog should cover every station that starts at once.
+	status = listen(tcp_s, backlog);
 	if (status == SOCKET_ERROR) {
-		fprintf(stderr, "listen() failed: %ld\n", WSAGetLastError());
+		fprintf(stderr, "listen() failed: %d\n", WSAGetLastError());
 		closesocket(tcp_s);
-		WSACleanup();
 		return INVALID_SOCKET;
 	}
 
 	return tcp_s;
 }
 
+// Function to accept every connection waiting on a listening socket, until accept()
+// would block. Returns the number of stations added.
+int accept_stations(SOCKET listen_socket) {
+	int accepted = 0;
+
+	for (;;) {
+		struct sockaddr_in peer_addr;
+		socklen_t peer_addr_len = sizeof(peer_addr);
+
+		SOCKET new_socket = accept(listen_socket, (struct sockaddr*)&peer_addr, &peer_addr_len);
+		if (new_socket == INVALID_SOCKET) {
+			int error = WSAGetLastError();
+			// A connection reset while queued is gone, the rest may still be waiting
+			if (error == WSAECONNRESET) {
+				continue;
+			}
+			if (error != WSAEWOULDBLOCK) {
+				fprintf(stderr, "accept() failed: %d\n", error);
+			}
+			break;
+		}
+
+		// Set new socket to non-blocking
+		u_long mode = 1;
+		ioctlsocket(new_socket, FIONBIO, &mode);
+
+		// Add the new client
+		ClientNode* new_client = add_client(new_socket, peer_addr);
+		if (!new_client) {
+			fprintf(stderr, "Failed to add new client, closing connection\n");
+			closesocket(new_socket);
+			break;
+		}
+		accepted++;
+	}
+
+	return accepted;
+}
+
+// Function to close the channel's listening sockets
+void close_listening_sockets(ChannelLoop* loop) {
+	for (int i = 0; i < loop->listen_count; i++) {
+		closesocket(loop->listen_sockets[i]);
+	}
+	loop->listen_count = 0;
+}
+
 // Function to ensure a client's buffer is large enough
 void ensure_buffer_capacity(ClientNode* client, int required_size) {
 	if (!client || required_size <= 0) return;
@@ -137,12 +224,74 @@ void ensure_buffer_capacity(ClientNode* client, int required_size) {
 	}
 }
 
+// Function to append what a station has sent to its buffer. The station's frames are
+// taken from there one per slot, however the stream was cut into reads.
+// Returns false if the station disconnected.
+bool client_receive(ClientNode* client) {
+	ClientInfo* info = &client->info;
+
+	// Room for everything available, and at least for the rest of a frame begun earlier
+	u_long bytes_available = 0;
+	ioctlsocket(info->socket, FIONREAD, &bytes_available);
+	int required = info->buffer_len + (bytes_available > 0 ? (int)bytes_available : 1);
+	if (info->buffer_len >= FRAME_HEADER_SIZE && frame_wire_size(info->buffer) > required) {
+		required = frame_wire_size(info->buffer);
+	}
+	ensure_buffer_capacity(client, required);
+
+	int bytes = recv(info->socket, info->buffer + info->buffer_len, info->buffer_size - info->buffer_len, 0);
+	if (bytes > 0) {
+		info->buffer_len += bytes;
+		return true;
+	}
+	if (bytes == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+		return true;
+	}
+
+	// Client disconnected or error
+	printf("Client disconnected: %s:%d\n",
+		inet_ntoa(info->addr.sin_addr),
+		ntohs(info->addr.sin_port));
+
+	// Mark as disconnected but keep in list
+	mark_client_disconnected(client);
+	return false;
+}
+
+// Function to check whether a complete frame is at the start of a station's buffer.
+// Returns its size on the wire, or 0 if it has not fully arrived yet.
+int client_next_frame(ClientNode* client) {
+	ClientInfo* info = &client->info;
+
+	if (info->buffer_len < FRAME_HEADER_SIZE) {
+		return 0;
+	}
+	int length = frame_wire_size(info->buffer);
+	return (length <= info->buffer_len) ? length : 0;
+}
+
+// Function to drop the frame at the start of a station's buffer once it has been handled
+void client_take_frame(ClientNode* client, int length) {
+	ClientInfo* info = &client->info;
+
+	info->buffer_len -= length;
+	if (info->buffer_len > 0) {
+		memmove(info->buffer, info->buffer + length, info->buffer_len);
+	}
+}
+
 // Mark a client as disconnected but keep it in the list for statistics
 void mark_client_disconnected(ClientNode* client) {
 	if (client && client->info.active) {
 		client->info.active = false;
 		client->info.connected = false;
 
+		if (live_stats && client->info.stats) {
+			stats_write_begin(live_stats);
+			client->info.stats->connected = 0;
+			stats_write_end(live_stats);
+		}
+
 	//	fprintf(stderr, "Server %s:%d disconnected (stats will be kept until exit)\n",
 	//		inet_ntoa(client->info.addr.sin_addr),
 	//		ntohs(client->info.addr.sin_port));
@@ -174,13 +323,27 @@ ClientNode* add_client(SOCKET socket, struct sockaddr_in addr) {
 	new_client->info.addr = addr;
 	new_client->info.total_frames = 0;
 	new_client->info.collision_count = 0;
+	new_client->info.corrupt_frames = 0;
+	new_client->info.deferred_frames = 0;
+	bucket_init(&new_client->info.bucket, station_rate, station_burst, now_ms());
 	new_client->info.first_frame_time = 0;
 	new_client->info.last_frame_time = 0;
 	new_client->info.total_bytes = 0;
 	new_client->info.active = true;
 	new_client->info.connected = true;
 	new_client->info.buffer_size = INITIAL_BUFFER_SIZE;
-	new_client->info.frame_length = 0;
+	new_client->info.buffer_len = 0;
+	new_client->info.out_buffer = NULL;
+	new_client->info.out_capacity = 0;
+	new_client->info.out_len = 0;
+	new_client->info.out_offset = 0;
+	new_client->info.poll_index = -1;
+	new_client->info.stats = NULL;
+	if (live_stats) {
+		stats_write_begin(live_stats);
+		new_client->info.stats = stats_add_station(live_stats, addr.sin_addr.s_addr, ntohs(addr.sin_port));
+		stats_write_end(live_stats);
+	}
 
 	// Add to the beginning of the list (O(1) operation)
 	new_client->next = client_list;
@@ -221,6 +384,7 @@ void cleanup_clients(void) {
 		}
 
 		free(current->info.buffer);
+		free(current->info.out_buffer);
 		free(current);
 
 		current = next;
@@ -233,23 +397,24 @@ void cleanup_clients(void) {
 // Create a noise frame to indicate collision
 char* create_noise_frame(void) {
 	// Allocate memory for the noise frame
-	char* noise_buffer = (char*)malloc(sizeof(FrameHeader));
+	char* noise_buffer = (char*)malloc(FRAME_HEADER_SIZE);
 	if (!noise_buffer) {
 		fprintf(stderr, "Failed to allocate memory for noise frame\n");
 		return NULL;
 	}
 
 	// Clear the frame first
-	memset(noise_buffer, 0, sizeof(FrameHeader));
+	FrameHeader noise;
+	memset(&noise, 0, sizeof(noise));
 
 	// Set fields
-	FrameHeader* noise = (FrameHeader*)noise_buffer;
-	noise->type = FRAME_TYPE_NOISE;
-	noise->seq_num = 0xFFFFFFFF;  // Special value
-	noise->length = sizeof(FrameHeader);
+	noise.type = FRAME_TYPE_NOISE;
+	noise.seq_num = 0xFFFFFFFF;  // Special value
+	noise.length = 0;           // Header only, no payload
+	frame_header_encode(&noise, noise_buffer);
 
 //	fprintf(stderr, "Created noise frame with Type: %d, Seq: %u, Length: %d\n",
-//		noise->type, noise->seq_num, noise->length);
+//		noise.type, noise.seq_num, noise.length);
 
 	return noise_buffer;
 }
@@ -264,7 +429,7 @@ void broadcast_noise_frame(char* noise_buffer) {
 
 	// Print the first few bytes of the noise frame for debugging
 	//fprintf(stderr, "Noise frame bytes: ");
-	unsigned char* bytes = (unsigned char*)noise_buffer;
+	//unsigned char* bytes = (unsigned char*)noise_buffer;
 	//for (int i = 0; i < 8; i++) {
 	//	fprintf(stderr, "%02X ", bytes[i]);
 //	}
@@ -272,32 +437,17 @@ void broadcast_noise_frame(char* noise_buffer) {
 
 	while (current != NULL) {
 		if (current->info.active) {
-			int sent = send(current->info.socket, noise_buffer, sizeof(FrameHeader), 0);
-
-			if (sent == SOCKET_ERROR) {
-				int err = WSAGetLastError();
-				failed_sends++;
-
-				fprintf(stderr, "  Failed to send to %s:%d - Error: %d\n",
-					inet_ntoa(current->info.addr.sin_addr),
-					ntohs(current->info.addr.sin_port),
-					err);
-
-				if (err != WSAEWOULDBLOCK) {
-					current->info.active = false;
-				}
-			}
-			else if (sent == sizeof(FrameHeader)) {
+			if (client_send(current, noise_buffer, FRAME_HEADER_SIZE)) {
 				successful_sends++;
 	//			fprintf(stderr, "  Sent noise frame to %s:%d\n",
 				//	inet_ntoa(current->info.addr.sin_addr),
 				//	ntohs(current->info.addr.sin_port));
 			}
 			else {
-	//			fprintf(stderr, "  Partial send to %s:%d: %d of %d bytes\n",
-				//	inet_ntoa(current->info.addr.sin_addr),
-				//	ntohs(current->info.addr.sin_port),
-				//	sent, (int)sizeof(FrameHeader));
+				failed_sends++;
+				fprintf(stderr, "  Failed to send to %s:%d\n",
+					inet_ntoa(current->info.addr.sin_addr),
+					ntohs(current->info.addr.sin_port));
 			}
 		}
 		current = current->next;
@@ -307,16 +457,11 @@ void broadcast_noise_frame(char* noise_buffer) {
 	//	successful_sends, failed_sends);
 }
 
-// Function to check for user input (Ctrl+Z)
+// Function to check for a shutdown request (Ctrl+Z or Ctrl+C)
 bool check_for_exit(void) {
-	// Check if stdin has input
-	if (_kbhit()) {
-		int c = _getch();
-		// Check for Control+Z (ASCII 26) or Control+C (ASCII 3)
-		if (c == 26 || c == 3) {
-			fprintf(stderr, "\nExit command detected (Ctrl+Z or Ctrl+C). Shutting down...\n");
-			return true;
-		}
+	if (platform_shutdown_requested()) {
+		fprintf(stderr, "\nExit command detected (Ctrl+Z or Ctrl+C). Shutting down...\n");
+		return true;
 	}
 	return false;
 }
@@ -327,18 +472,8 @@ void broadcast_to_all(char* buffer, int length) {
 	int successful_sends = 0;
 
 	while (current != NULL) {
-		if (current->info.active) {
-			int sent = send(current->info.socket, buffer, length, 0);
-			if (sent == SOCKET_ERROR) {
-				int err = WSAGetLastError();
-				if (err != WSAEWOULDBLOCK) {
-		//			fprintf(stderr, "Error sending to client: %d\n", err);
-					current->info.active = false;
-				}
-			}
-			else if (sent == length) {
-				successful_sends++;
-			}
+		if (current->info.active && client_send(current, buffer, length)) {
+			successful_sends++;
 		}
 		current = current->next;
 	}
@@ -346,13 +481,215 @@ void broadcast_to_all(char* buffer, int length) {
 	//fprintf(stderr, "Broadcast frame to %d active clients\n", successful_sends);
 }
 
+// Function to send a frame to one station. Whatever the socket does not take now is
+// queued and sent by client_flush() once it drains, so a station never sees part of
+// a frame followed by the next one. A station that fails, or falls further behind than
+// MAX_QUEUED_BYTES, is disconnected. Returns false if the station was disconnected.
+bool client_send(ClientNode* client, const char* data, int length) {
+	ClientInfo* info = &client->info;
+	int sent = 0;
+
+	// Nothing may overtake bytes still queued
+	if (info->out_len == 0) {
+		sent = send(info->socket, data, length, 0);
+		if (sent == SOCKET_ERROR) {
+			if (WSAGetLastError() != WSAEWOULDBLOCK) {
+				mark_client_disconnected(client);
+				return false;
+			}
+			sent = 0;
+		}
+		if (sent == length) {
+			return true;
+		}
+	}
+
+	// Move the unsent bytes to the front, then append the rest of this frame
+	if (info->out_offset > 0) {
+		memmove(info->out_buffer, info->out_buffer + info->out_offset, info->out_len - info->out_offset);
+		info->out_len -= info->out_offset;
+		info->out_offset = 0;
+	}
+	int needed = info->out_len + length - sent;
+	if (needed > MAX_QUEUED_BYTES) {
+		fprintf(stderr, "Station %s:%d is not reading, %d bytes queued - disconnecting it\n",
+			inet_ntoa(info->addr.sin_addr), ntohs(info->addr.sin_port), info->out_len);
+		mark_client_disconnected(client);
+		return false;
+	}
+	if (needed > info->out_capacity) {
+		int capacity = (info->out_capacity > 0) ? info->out_capacity : INITIAL_BUFFER_SIZE;
+		while (capacity < needed) {
+			capacity *= 2;
+		}
+		char* grown = (char*)realloc(info->out_buffer, capacity);
+		if (!grown) {
+			fprintf(stderr, "Memory allocation failed for a station's send queue, disconnecting it\n");
+			mark_client_disconnected(client);
+			return false;
+		}
+		info->out_buffer = grown;
+		info->out_capacity = capacity;
+	}
+	memcpy(info->out_buffer + info->out_len, data + sent, length - sent);
+	info->out_len = needed;
+	return true;
+}
+
+// Function to send the bytes queued for a station while its socket takes them.
+// Returns false if the station was disconnected.
+bool client_flush(ClientNode* client) {
+	ClientInfo* info = &client->info;
+
+	while (info->out_offset < info->out_len) {
+		int sent = send(info->socket, info->out_buffer + info->out_offset, info->out_len - info->out_offset, 0);
+		if (sent == SOCKET_ERROR) {
+			if (WSAGetLastError() == WSAEWOULDBLOCK) {
+				return true;
+			}
+			mark_client_disconnected(client);
+			return false;
+		}
+		info->out_offset += sent;
+	}
+
+	info->out_len = 0;
+	info->out_offset = 0;
+	return true;
+}
+
+// Function to record a slot with traffic in the trace, with what the replay tool needs
+// to decide it again: when each frame arrived, the CRC values the channel saw and the
+// link model. Only copies into the ring, the file is written by the trace thread.
+void trace_slot(Trace* trace, uint32_t slot, const LinkModel* link, double now, int outcome,
+	ReceivedFrame* frames, int frame_count) {
+	TraceRecord* record = trace_begin(trace);
+	if (!record) {
+		return;  // Ring full, counted as dropped
+	}
+
+	record->slot = slot;
+	record->outcome = (uint8_t)outcome;
+	record->sender_count = (uint8_t)(frame_count > 255 ? 255 : frame_count);
+	record->frame_count = (uint8_t)(frame_count > TRACE_MAX_FRAMES ? TRACE_MAX_FRAMES : frame_count);
+	record->reserved = 0;
+	record->decided_ms = now - trace->start_ms;
+	record->link_rate_bps = link->rate_bps;
+	record->propagation_ms = link->propagation_ms;
+	for (int i = 0; i < record->frame_count; i++) {
+		TraceFrame* entry = &record->frames[i];
+		ClientNode* sender = (ClientNode*)frames[i].sender;
+		const char* frame = frames[i].buffer;
+		entry->sender_ip = sender->info.addr.sin_addr.s_addr;
+		entry->sender_port = ntohs(sender->info.addr.sin_port);
+		entry->reserved = 0;
+		entry->bytes = frames[i].length;
+		entry->arrival_ms = frames[i].arrival_ms - trace->start_ms;
+
+		// The trailer as received and the CRC over what was received, whatever the outcome
+		entry->crc_trailer = 0;
+		entry->crc_computed = 0;
+		int covered = FRAME_HEADER_SIZE + frame_wire_length(frame);
+		if ((frame_wire_type(frame) & FRAME_FLAG_CRC) && covered + CRC32C_SIZE <= frames[i].length) {
+			entry->crc_trailer = wire_get_u32(frame + covered);
+			entry->crc_computed = crc32c(0, frame, covered);
+		}
+		memcpy(entry->header, frame, TRACE_HEADER_BYTES);
+	}
+
+	trace_commit(trace);
+}
+
+// Function to publish a slot to the statistics segment: the outcome and the counters of
+// every sender in it. Plain stores inside the sequence lock, no system call.
+void publish_slot_stats(StatsSegment* segment, uint32_t slot, int outcome, ReceivedFrame* frames, int frame_count) {
+	stats_write_begin(segment);
+
+	segment->slots = slot;
+	if (frame_count > 0) {
+		segment->busy_slots++;
+	}
+	if (outcome == SLOT_DELIVERED) {
+		segment->delivered_slots++;
+	}
+	else if (outcome == SLOT_COLLISION) {
+		segment->collision_slots++;
+	}
+	else if (outcome == SLOT_CORRUPT) {
+		segment->corrupt_slots++;
+	}
+
+	for (int i = 0; i < frame_count; i++) {
+		ClientInfo* info = &((ClientNode*)frames[i].sender)->info;
+		StatsStation* station = info->stats;
+
+		if (!station) {
+			continue;
+		}
+		station->frames = info->total_frames;
+		station->bytes = info->total_bytes;
+		station->collisions = info->collision_count;
+		station->corrupt = info->corrupt_frames;
+		if (outcome == SLOT_DELIVERED) {
+			station->delivered++;
+		}
+	}
+
+	stats_write_end(segment);
+}
+
+// Function to charge a frame to the rate limits of its station and of its source MAC.
+// Returns 0 if the frame is admitted, otherwise the milliseconds until it would be -
+// the frame then takes no token from either bucket.
+int admit_frame(ClientNode* client, const char* frame, double now) {
+	MacLimit* mac_limit = mac_limit_count > 0 ?
+		mac_limit_find(mac_limits, mac_limit_count, (const uint8_t*)frame + FRAME_OFFSET_SRC_MAC) : NULL;
+
+	double wait_ms = bucket_refill(&client->info.bucket, now);
+	if (mac_limit) {
+		double mac_wait_ms = bucket_refill(&mac_limit->bucket, now);
+		if (mac_wait_ms > wait_ms) {
+			wait_ms = mac_wait_ms;
+		}
+	}
+
+	if (wait_ms > 0) {
+		if (mac_limit) {
+			mac_limit->deferred++;
+		}
+		// Round up, so the retry finds the token there
+		return wait_ms < 65535 ? (int)wait_ms + 1 : 65535;
+	}
+
+	bucket_take(&client->info.bucket);
+	if (mac_limit) {
+		bucket_take(&mac_limit->bucket);
+	}
+	return 0;
+}
+
+// Function to tell a station its frame was turned away: the frame's header with type
+// DEFER, followed by the time after which a retry will be admitted
+void send_deferral(ClientNode* client, const char* frame, int retry_after_ms) {
+	char deferral[FRAME_HEADER_SIZE + DEFER_BODY_SIZE];
+	FrameHeader header;
+
+	frame_header_decode(frame, &header);
+	header.type = FRAME_TYPE_DEFER;
+	header.length = DEFER_BODY_SIZE;
+	frame_header_encode(&header, deferral);
+	wire_put_u16(deferral + FRAME_HEADER_SIZE, (uint16_t)retry_after_ms);
+
+	client_send(client, deferral, sizeof(deferral));
+}
+
 // Function to calculate average bandwidth in Mbps
-double calculate_bandwidth(int64_t bytes, clock_t start_time, clock_t end_time) {
-	if (start_time == 0 || end_time <= start_time) {
+double calculate_bandwidth(int64_t bytes, double start_ms, double end_ms) {
+	if (start_ms == 0 || end_ms <= start_ms) {
 		return 0.0;
 	}
 
-	double duration_sec = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+	double duration_sec = (end_ms - start_ms) / 1000.0;
 	if (duration_sec <= 0) {
 		return 0.0;
 	}
@@ -383,227 +720,477 @@ void print_all_statistics(void) {
 				current->info.collision_count);
 
 			fprintf(stderr, "Average bandwidth: %.3f Mbps\n", bandwidth_mbps);
+			if (current->info.corrupt_frames > 0) {
+				fprintf(stderr, "Corrupt frames (CRC mismatch, answered with noise): %d\n",
+					current->info.corrupt_frames);
+			}
+		}
+		if (current->info.deferred_frames > 0) {
+			fprintf(stderr, "Deferred frames (over the rate limit) from %s port %d: %d\n",
+				inet_ntoa(current->info.addr.sin_addr),
+				ntohs(current->info.addr.sin_port),
+				current->info.deferred_frames);
 		}
 		current = current->next;
 	}
-}
 
-int main(int argc, char *argv[]) {
-	if (argc != 3) {
-		fprintf(stderr, "Usage: %s <chan_port> <slot_time_ms>\n", argv[0]);
-		return 1;
+	for (int i = 0; i < mac_limit_count; i++) {
+		const uint8_t* mac = mac_limits[i].mac;
+		fprintf(stderr, "Deferred frames from MAC %02X:%02X:%02X:%02X:%02X:%02X (%.1f frames/s): %lld\n",
+			mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], mac_limits[i].bucket.rate,
+			(long long)mac_limits[i].deferred);
 	}
+}
 
-	int chan_port = atoi(argv[1]);
-	int slot_time_ms = atoi(argv[2]);
+// Function to print how much of the time the medium was in use
+void print_link_statistics(const LinkModel* link) {
+	double span_ms = link->last_ms - link->first_ms;
 
-	// Create the listening socket
-	SOCKET tcp_s = create_listening_socket(chan_port);
-	if (tcp_s == INVALID_SOCKET) {
-		return 1;
+	fprintf(stderr, "Link: %.3f Mbps, %.1f us propagation delay\n",
+		link->rate_bps / 1000000.0, link->propagation_ms * 1000.0);
+	if (span_ms > 0) {
+		fprintf(stderr, "Medium busy %.1f%% of the time, %.1f%% carrying delivered frames\n",
+			100.0 * link->airtime_ms / span_ms, 100.0 * link->delivered_ms / span_ms);
 	}
+}
 
-	printf("Channel listening on port %d with slot time %d ms\n", chan_port, slot_time_ms);
+// Function to run one slot of the channel: wait up to a slot time for traffic, accept
+// new stations, read every station that sent something, take one whole frame from each
+// (split by the length field, partial frames stay buffered) and broadcast the outcome.
+// With the link model, frames stay on the medium for their airtime and the outcome is
+// broadcast in the slot in which the medium goes quiet.
+// Returns the slot's outcome (SLOT_IDLE if nothing was decided).
+int run_channel_slot(ChannelLoop* loop) {
+	loop->slot++;
+	bool link_model = link_enabled(&loop->link);
+
+	// Poll set: the listening sockets, then all active client sockets
+	int poll_count = loop->listen_count + client_count;
+	if (poll_count > loop->poll_capacity) {
+		int capacity = (loop->poll_capacity > 0) ? loop->poll_capacity : 64;
+		while (capacity < poll_count) {
+			capacity *= 2;
+		}
+		PlatformPollFd* grown = (PlatformPollFd*)realloc(loop->poll_fds, capacity * sizeof(PlatformPollFd));
+		if (!grown) {
+			fprintf(stderr, "Memory allocation failed for the poll set\n");
+			Sleep(100);
+			return SLOT_IDLE;
+		}
+		loop->poll_fds = grown;
+		loop->poll_capacity = capacity;
+	}
 
-	// Create the noise frame once at startup
-	char* noise_buffer = create_noise_frame();
-	if (!noise_buffer) {
-	//	fprintf(stderr, "Failed to create noise frame, exiting\n");
-		closesocket(tcp_s);
-		WSACleanup();
-		return 1;
+	poll_count = 0;
+	for (int i = 0; i < loop->listen_count; i++) {
+		loop->poll_fds[poll_count].fd = loop->listen_sockets[i];
+		loop->poll_fds[poll_count].events = POLLIN;
+		loop->poll_fds[poll_count].revents = 0;
+		poll_count++;
 	}
 
-	// Main channel loop
-	bool running = true;
-	while (running) {
-		// Check for exit command (Ctrl+Z)
-		if (check_for_exit()) {
-			running = false;
-			break;
+	// A station with a whole frame already buffered has traffic for this slot
+	bool frame_waiting = false;
+	ClientNode* current = client_list;
+	while (current != NULL) {
+		current->info.poll_index = -1;
+		if (current->info.active) {
+			frame_waiting |= (client_next_frame(current) > 0);
+			current->info.poll_index = poll_count;
+			loop->poll_fds[poll_count].fd = current->info.socket;
+			loop->poll_fds[poll_count].events = POLLIN;
+			if (current->info.out_len > 0) {
+				loop->poll_fds[poll_count].events |= POLLOUT;   // Queued bytes to flush
+			}
+			loop->poll_fds[poll_count].revents = 0;
+			poll_count++;
 		}
+		current = current->next;
+	}
 
-		// Setup for select() on listening socket and client sockets
-		fd_set readfds;
-		FD_ZERO(&readfds);
-		FD_SET(tcp_s, &readfds);
+	// Wait with timeout: a slot time, or until the frames on the medium have left it
+	double wait_ms = frame_waiting ? 0 : loop->slot_time_ms;
+	if (link_model && loop->link.count > 0) {
+		double left_ms = loop->link.busy_until - now_ms();
+		if (left_ms < wait_ms) {
+			wait_ms = (left_ms > 0) ? left_ms : 0;
+		}
+	}
 
-		// Add all active client sockets to the set
-		ClientNode* current = client_list;
-		while (current != NULL) {
-			if (current->info.active) {
-				FD_SET(current->info.socket, &readfds);
-			}
-			current = current->next;
+	int ready_count = platform_poll(loop->poll_fds, poll_count, wait_ms);
+	if (ready_count == SOCKET_ERROR) {
+		if (WSAGetLastError() == WSAEINTR) {
+			return SLOT_IDLE;    // A signal, e.g. the shutdown request checked by the main loop
 		}
+		fprintf(stderr, "poll() failed: %d\n", WSAGetLastError());
+		Sleep(100); // Avoid busy waiting in case of persistent error
+		return SLOT_IDLE;
+	}
 
-		// Wait with timeout
-		struct timeval timeout;
-		timeout.tv_sec = 0;
-		timeout.tv_usec = slot_time_ms * 1000; // Convert ms to μs
+	// Admit every station waiting on the listening sockets, not just one per slot
+	for (int i = 0; i < loop->listen_count; i++) {
+		if (loop->poll_fds[i].revents & POLLIN) {
+			accept_stations(loop->listen_sockets[i]);
+		}
+	}
 
-		int ready_count = select(0, &readfds, NULL, NULL, &timeout);
-		if (ready_count == SOCKET_ERROR) {
-			fprintf(stderr, "select() failed: %d\n", WSAGetLastError());
-			Sleep(100); // Avoid busy waiting in case of persistent error
-			continue;
+	// Allocate array for received frames
+	ReceivedFrame* received_frames = NULL;
+	if (client_count > 0) {
+		received_frames = (ReceivedFrame*)malloc(client_count * sizeof(ReceivedFrame));
+		if (!received_frames) {
+			fprintf(stderr, "Memory allocation failed for received frames\n");
+			return SLOT_IDLE;
 		}
 
-		// Check for accept on listening socket
-		if (FD_ISSET(tcp_s, &readfds)) {
-			struct sockaddr_in peer_addr;
-			int peer_addr_len = sizeof(peer_addr);
+		// Initialize buffer pointers to NULL for safe cleanup
+		for (int i = 0; i < client_count; i++) {
+			received_frames[i].buffer = NULL;
+		}
+	}
 
-			SOCKET new_socket = accept(tcp_s, (struct sockaddr*)&peer_addr, &peer_addr_len);
-			if (new_socket != INVALID_SOCKET) {
-				// Set new socket to non-blocking
-				u_long mode = 1;
-				ioctlsocket(new_socket, FIONBIO, &mode);
+	// One time for the iteration: arrivals, admission and whether the medium is quiet
+	int frames_received = 0;
+	bool rate_limited = (station_rate > 0 || mac_limit_count > 0);
+	double now = now_ms();
 
-				// Add the new client
-				ClientNode* new_client = add_client(new_socket, peer_addr);
-				if (!new_client) {
-					fprintf(stderr, "Failed to add new client, closing connection\n");
-					closesocket(new_socket);
+	// Check client sockets for data
+	current = client_list;
+	while (current != NULL) {
+		ClientNode* next = current->next; // Save next pointer in case current gets removed
+
+		short revents = (current->info.active && current->info.poll_index >= 0) ?
+			loop->poll_fds[current->info.poll_index].revents : 0;
+		if (revents & POLLOUT) {
+			client_flush(current);
+		}
+
+		// A closed or failed connection is read too, recv() reports it
+		if (current->info.active && (revents & ~POLLOUT) != 0) {
+			client_receive(current);
+		}
+
+		// One frame per station and slot, any further frames wait for the next slots
+		int frame_len = current->info.active ? client_next_frame(current) : 0;
+		const char* frame = current->info.buffer;
+
+		int retry_after_ms = (frame_len > 0 && rate_limited) ? admit_frame(current, frame, now) : 0;
+
+		if (retry_after_ms > 0) {
+			// Over budget - the frame does not take part in the slot, so it cannot
+			// collide with the other stations' frames
+			current->info.deferred_frames++;
+			send_deferral(current, frame, retry_after_ms);
+			if (live_stats) {
+				stats_write_begin(live_stats);
+				live_stats->deferred_frames++;
+				if (current->info.stats) {
+					current->info.stats->deferred = current->info.deferred_frames;
 				}
+				stats_write_end(live_stats);
 			}
 		}
+		else if (frame_len > 0) {
+			// Store frame for later processing
+			if (received_frames && frames_received < client_count) {
+				received_frames[frames_received].buffer = malloc(frame_len);
+				if (received_frames[frames_received].buffer) {
+					memcpy(received_frames[frames_received].buffer, frame, frame_len);
+					received_frames[frames_received].length = frame_len;
+					received_frames[frames_received].arrival_ms = now;
+					received_frames[frames_received].sender = current;
+					frames_received++;
+				}
+				else {
+					fprintf(stderr, "Failed to allocate memory for frame data\n");
+				}
+			}
 
-		// Arrays to track received frames in this slot
-		typedef struct {
-			char* buffer;
-			int length;
-			ClientNode* sender;
-		} ReceivedFrame;
-
-		// Allocate array for received frames
-		ReceivedFrame* received_frames = NULL;
-		if (client_count > 0) {
-			received_frames = (ReceivedFrame*)malloc(client_count * sizeof(ReceivedFrame));
-			if (!received_frames) {
-				fprintf(stderr, "Memory allocation failed for received frames\n");
-				continue;
+			// Update statistics
+			current->info.total_frames++;
+			if (current->info.first_frame_time == 0) {
+				current->info.first_frame_time = now_ms();
 			}
+			current->info.last_frame_time = now_ms();
+			current->info.total_bytes += frame_len;
+
+			// Print received message information
+/*			printf("Received frame from %s:%d - Type: %d, Length: %d bytes\n",
+				inet_ntoa(current->info.addr.sin_addr),
+				ntohs(current->info.addr.sin_port),
+				frame_wire_type(frame),
+				frame_len);*/
+		}
+		if (frame_len > 0) {
+			client_take_frame(current, frame_len);
+		}
 
-			// Initialize buffer pointers to NULL for safe cleanup
-			for (int i = 0; i < client_count; i++) {
-				received_frames[i].buffer = NULL;
+		current = next;
+	}
+
+	// The frames this slot decides: those received, or with the link model those on the
+	// medium once it is quiet (same code as the replay tool)
+	ReceivedFrame* frames;
+	int frame_count;
+	int outcome = channel_decide_slot(&loop->link, received_frames, &frames_received, now,
+		&frames, &frame_count);
+	if (outcome == SLOT_CORRUPT) {
+		// A damaged frame is never delivered - the senders see noise and retransmit
+		((ClientNode*)frames[0].sender)->info.corrupt_frames++;
+		broadcast_noise_frame(loop->noise_buffer);
+	}
+	else if (outcome == SLOT_DELIVERED) {
+		// No collision - broadcast the frame to all clients
+/*		printf("Broadcasting frame - Type: %d, Length: %d bytes\n",
+			frame_wire_type(frames[0].buffer),
+			frames[0].length);
+			*/
+		broadcast_to_all(frames[0].buffer, frames[0].length);
+	}
+	else if (outcome == SLOT_COLLISION) {
+		// Collision detected
+		printf("COLLISION DETECTED: %d frames received simultaneously\n", frame_count);
+
+		// Use the specialized function to broadcast the noise frame
+		broadcast_noise_frame(loop->noise_buffer);
+
+		// Update collision statistics
+		for (int k = 0; k < frame_count; k++) {
+			ClientNode* sender = (ClientNode*)frames[k].sender;
+			if (sender) {
+				sender->info.collision_count++;
+	/*			printf("Incremented collision count for %s:%d to %d\n",
+					inet_ntoa(sender->info.addr.sin_addr),
+					ntohs(sender->info.addr.sin_port),
+					sender->info.collision_count);*/
 			}
 		}
+	}
 
-		int frames_received = 0;
+	// Record the slot once its outcome is on the way to the stations
+	if (loop->trace && frame_count > 0) {
+		trace_slot(loop->trace, loop->slot, &loop->link, now, outcome, frames, frame_count);
+	}
 
-		// Check client sockets for data
-		current = client_list;
-		while (current != NULL) {
-			ClientNode* next = current->next; // Save next pointer in case current gets removed
+	if (live_stats) {
+		publish_slot_stats(live_stats, loop->slot, outcome, frames, frame_count);
+	}
 
-			if (current->info.active && FD_ISSET(current->info.socket, &readfds)) {
-				// Check how many bytes are available
-				u_long bytes_available = 0;
-				if (ioctlsocket(current->info.socket, FIONREAD, &bytes_available) == 0 && bytes_available > 0) {
-					// Ensure buffer is large enough
-					ensure_buffer_capacity(current, bytes_available);
-				}
+	channel_end_slot(&loop->link, outcome, frame_count);
 
-				int bytes = recv(current->info.socket, current->info.buffer, current->info.buffer_size, 0);
-
-				if (bytes > 0 && bytes >= sizeof(FrameHeader)) {
-					current->info.frame_length = bytes;
-
-					// Store frame for later processing
-					if (received_frames && frames_received < client_count) {
-						received_frames[frames_received].buffer = malloc(bytes);
-						if (received_frames[frames_received].buffer) {
-							memcpy(received_frames[frames_received].buffer, current->info.buffer, bytes);
-							received_frames[frames_received].length = bytes;
-							received_frames[frames_received].sender = current;
-							frames_received++;
-						}
-						else {
-							fprintf(stderr, "Failed to allocate memory for frame data\n");
-						}
-					}
-
-					// Update statistics
-					current->info.total_frames++;
-					if (current->info.first_frame_time == 0) {
-						current->info.first_frame_time = clock();
-					}
-					current->info.last_frame_time = clock();
-					current->info.total_bytes += bytes;
-
-					// Print received message information
-					FrameHeader* header = (FrameHeader*)current->info.buffer;
-		/*			printf("Received frame from %s:%d - Type: %d, Seq: %u, Length: %d bytes\n",
-						inet_ntoa(current->info.addr.sin_addr),
-						ntohs(current->info.addr.sin_port),
-						header->type,
-						header->seq_num,
-						bytes);*/
-				}
-				else if (bytes == 0 || (bytes == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK)) {
-					// Client disconnected or error
-					printf("Client disconnected: %s:%d\n",
-						inet_ntoa(current->info.addr.sin_addr),
-						ntohs(current->info.addr.sin_port));
-						
-					// Mark as disconnected but keep in list
-					mark_client_disconnected(current);
-				}
+	// Free the received frames
+	if (received_frames) {
+		for (int i = 0; i < frames_received; i++) {
+			if (received_frames[i].buffer) {
+				free(received_frames[i].buffer);
 			}
+		}
+		free(received_frames);
+	}
 
-			current = next;
-		}
-
-		// Process received frames
-		if (frames_received == 1) {
-			// No collision - broadcast the frame to all clients
-			FrameHeader* header = (FrameHeader*)received_frames[0].buffer;
-	/*		printf("Broadcasting frame - Type: %d, Seq: %u, Length: %d bytes\n",
-				header->type,
-				header->seq_num,
-				received_frames[0].length);
-				*/
-			broadcast_to_all(received_frames[0].buffer, received_frames[0].length);
-		}
-		else if (frames_received > 1) {
-			// Collision detected
-			printf("COLLISION DETECTED: %d frames received simultaneously\n", frames_received);
-
-			// Use the specialized function to broadcast the noise frame
-			broadcast_noise_frame(noise_buffer);
-
-			// Update collision statistics
-			for (int k = 0; k < frames_received; k++) {
-				if (received_frames[k].sender) {
-					received_frames[k].sender->info.collision_count++;
-		/*			printf("Incremented collision count for %s:%d to %d\n",
-						inet_ntoa(received_frames[k].sender->info.addr.sin_addr),
-						ntohs(received_frames[k].sender->info.addr.sin_port),
-						received_frames[k].sender->info.collision_count);*/
-				}
+	return outcome;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <chan_port> <slot_time_ms> [options]\n", argv[0]);
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -trace <file>        Record every slot with traffic to a pcap file\n");
+		fprintf(stderr, "  -no-stats            Do not publish live statistics (read with statview)\n");
+		fprintf(stderr, "  -backlog <n>         Pending connections per listening socket (default %d)\n", DEFAULT_BACKLOG);
+		fprintf(stderr, "  -acceptors <n>       Listening sockets sharing the port with SO_REUSEPORT (1-%d)\n", MAX_ACCEPTORS);
+		fprintf(stderr, "  -rate <fps> <burst>  Limit every station to fps frames/s, bursts of up to burst frames\n");
+		fprintf(stderr, "  -mac-rate <mac> <fps> <burst>\n");
+		fprintf(stderr, "                       Limit frames from one source MAC (up to %d MACs)\n", MAX_MAC_LIMITS);
+		fprintf(stderr, "  -link-rate <mbps>    Frames occupy the medium for their length at this rate;\n");
+		fprintf(stderr, "                       frames that overlap on it collide\n");
+		fprintf(stderr, "  -prop-delay <us>     Propagation delay added to every frame's time on the medium\n");
+		return 1;
+	}
+
+	int chan_port = atoi(argv[1]);
+	int slot_time_ms = atoi(argv[2]);
+
+	// Parse optional arguments
+	const char* trace_file = NULL;
+	bool publish_stats = true;
+	int backlog = DEFAULT_BACKLOG;
+	int acceptors = 1;
+	double link_rate_mbps = 0;
+	double propagation_us = 0;
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+			trace_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-no-stats") == 0) {
+			publish_stats = false;
+		}
+		else if (strcmp(argv[i], "-backlog") == 0 && i + 1 < argc) {
+			backlog = atoi(argv[++i]);
+			if (backlog < 1) {
+				fprintf(stderr, "Backlog must be at least 1\n");
+				return 1;
 			}
 		}
-
-		// Free the received frames
-		if (received_frames) {
-			for (int i = 0; i < frames_received; i++) {
-				if (received_frames[i].buffer) {
-					free(received_frames[i].buffer);
-				}
+		else if (strcmp(argv[i], "-rate") == 0 && i + 2 < argc) {
+			station_rate = atof(argv[++i]);
+			station_burst = atof(argv[++i]);
+			if (station_rate <= 0 || station_burst < 1) {
+				fprintf(stderr, "Rate must be positive and burst at least 1\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-mac-rate") == 0 && i + 3 < argc) {
+			MacLimit* limit = &mac_limits[mac_limit_count];
+			if (mac_limit_count == MAX_MAC_LIMITS || !parse_mac(argv[i + 1], limit->mac)) {
+				fprintf(stderr, "Invalid or too many MAC limits: %s\n", argv[i + 1]);
+				return 1;
+			}
+			double rate = atof(argv[i + 2]);
+			double burst = atof(argv[i + 3]);
+			if (rate <= 0 || burst < 1) {
+				fprintf(stderr, "Rate must be positive and burst at least 1\n");
+				return 1;
+			}
+			bucket_init(&limit->bucket, rate, burst, now_ms());
+			limit->deferred = 0;
+			mac_limit_count++;
+			i += 3;
+		}
+		else if (strcmp(argv[i], "-link-rate") == 0 && i + 1 < argc) {
+			link_rate_mbps = atof(argv[++i]);
+			if (link_rate_mbps <= 0) {
+				fprintf(stderr, "Link rate must be positive\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-prop-delay") == 0 && i + 1 < argc) {
+			propagation_us = atof(argv[++i]);
+			if (propagation_us < 0) {
+				fprintf(stderr, "Propagation delay cannot be negative\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-acceptors") == 0 && i + 1 < argc) {
+			acceptors = atoi(argv[++i]);
+			if (acceptors < 1 || acceptors > MAX_ACCEPTORS) {
+				fprintf(stderr, "Acceptors must be between 1 and %d\n", MAX_ACCEPTORS);
+				return 1;
 			}
-			free(received_frames);
 		}
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Initialize Winsock
+	WSADATA wsaData;
+	int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+	if (iResult != 0) {
+		fprintf(stderr, "Error at WSAStartup(): %d\n", iResult);
+		return 1;
+	}
+
+	// Ctrl+Z / Ctrl+C end the main loop below instead of the process
+	platform_catch_shutdown();
+
+#ifndef SO_REUSEPORT
+	if (acceptors > 1) {
+		fprintf(stderr, "SO_REUSEPORT is not available on this system, using one listening socket\n");
+		acceptors = 1;
+	}
+#endif
+
+	// Create the listening sockets
+	ChannelLoop loop;
+	loop.listen_count = 0;
+	while (loop.listen_count < acceptors) {
+		SOCKET listen_socket = create_listening_socket(chan_port, backlog, acceptors > 1);
+		if (listen_socket == INVALID_SOCKET) {
+			close_listening_sockets(&loop);
+			WSACleanup();
+			return 1;
+		}
+		loop.listen_sockets[loop.listen_count++] = listen_socket;
+	}
+
+	printf("Channel listening on port %d with slot time %d ms\n", chan_port, slot_time_ms);
+
+	// Create the noise frame once at startup
+	char* noise_buffer = create_noise_frame();
+	if (!noise_buffer) {
+	//	fprintf(stderr, "Failed to create noise frame, exiting\n");
+		close_listening_sockets(&loop);
+		WSACleanup();
+		return 1;
+	}
+
+	// Start the slot trace, written out by its own thread
+	Trace trace;
+	bool tracing = false;
+	if (trace_file) {
+		tracing = trace_open(&trace, trace_file, TRACE_DEFAULT_CAPACITY);
+		if (!tracing) {
+			free(noise_buffer);
+			close_listening_sockets(&loop);
+			WSACleanup();
+			return 1;
+		}
+	}
+
+	// Publish live statistics; the channel runs without them if the segment is unavailable
+	StatsShm stats_shm = { 0 };
+	if (publish_stats && stats_create(&stats_shm, chan_port, slot_time_ms)) {
+		live_stats = stats_shm.segment;
+	}
+
+	// Main channel loop
+	loop.slot_time_ms = slot_time_ms;
+	loop.noise_buffer = noise_buffer;
+	loop.trace = tracing ? &trace : NULL;
+	loop.slot = 0;
+	memset(&loop.link, 0, sizeof(loop.link));
+	loop.poll_fds = NULL;
+	loop.poll_capacity = 0;
+	loop.link.rate_bps = link_rate_mbps * 1000000.0;
+	loop.link.propagation_ms = propagation_us / 1000.0;
+	bool running = true;
+	while (running) {
+		// Check for exit command (Ctrl+Z)
+		if (check_for_exit()) {
+			running = false;
+			break;
+		}
+
+		run_channel_slot(&loop);
 	}
 
 	// Print statistics after Ctrl+Z
 	print_all_statistics();
+	if (link_enabled(&loop.link)) {
+		print_link_statistics(&loop.link);
+	}
+
+	if (tracing) {
+		trace_close(&trace);
+		fprintf(stderr, "Trace: %lld slots written to %s, %lld dropped (ring full)\n",
+			(long long)trace.recorded, trace_file, (long long)trace.dropped);
+	}
+
+	if (live_stats) {
+		InterlockedExchange(&live_stats->running, 0);
+		live_stats = NULL;
+		stats_close(&stats_shm);
+	}
 
 	// Clean up and free resources
+	link_clear(&loop.link);    // Frames still on the medium at shutdown
+	free(loop.link.frames);
+	free(loop.poll_fds);
 	cleanup_clients();
 	free(noise_buffer);  // Free the noise frame buffer
-	closesocket(tcp_s);
+	close_listening_sockets(&loop);
 	WSACleanup();
 
 	return 0;
@@ -0,0 +1,116 @@
+// channel_core.c - slot decision of the channel (link model and outcome), shared with the
+// trace replay tool
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "channel_core.h"
+#include "crc32c.h"
+#include "frame_codec.h"
+
+bool link_enabled(const LinkModel* link) {
+	return link->rate_bps > 0 || link->propagation_ms > 0;
+}
+
+double link_airtime_ms(const LinkModel* link, int length) {
+	double transmit_ms = (link->rate_bps > 0) ? length * 8.0 * 1000.0 / link->rate_bps : 0.0;
+	return transmit_ms + link->propagation_ms;
+}
+
+bool link_add_frames(LinkModel* link, ReceivedFrame* frames, int count) {
+	if (link->count + count > link->capacity) {
+		int capacity = (link->capacity > 0) ? link->capacity : 8;
+		while (capacity < link->count + count) {
+			capacity *= 2;
+		}
+		ReceivedFrame* grown = (ReceivedFrame*)realloc(link->frames, capacity * sizeof(ReceivedFrame));
+		if (!grown) {
+			fprintf(stderr, "Memory allocation failed for frames on the medium\n");
+			for (int i = 0; i < count; i++) {
+				free(frames[i].buffer);
+			}
+			return false;
+		}
+		link->frames = grown;
+		link->capacity = capacity;
+	}
+
+	for (int i = 0; i < count; i++) {
+		double arrival = frames[i].arrival_ms;
+		if (link->count == 0) {
+			link->busy_from = arrival;
+			link->busy_until = arrival;
+			if (link->first_ms == 0) {
+				link->first_ms = arrival;
+			}
+		}
+		double until = arrival + link_airtime_ms(link, frames[i].length);
+		if (until > link->busy_until) {
+			link->busy_until = until;
+		}
+		link->frames[link->count++] = frames[i];
+	}
+	return true;
+}
+
+void link_clear(LinkModel* link) {
+	for (int i = 0; i < link->count; i++) {
+		free(link->frames[i].buffer);
+	}
+	link->count = 0;
+}
+
+int channel_decide_slot(LinkModel* link, ReceivedFrame* frames, int* count, double now,
+	ReceivedFrame** decided, int* decided_count) {
+	*decided = frames;
+	*decided_count = *count;
+	if (link_enabled(link)) {
+		if (*count > 0) {
+			link_add_frames(link, frames, *count);
+			*count = 0;     // The buffers belong to the link now
+		}
+		bool quiet = (link->count > 0 && now >= link->busy_until);
+		*decided = link->frames;
+		*decided_count = quiet ? link->count : 0;
+	}
+
+	return channel_resolve_slot(*decided_count,
+		*decided_count > 0 ? (*decided)[0].buffer : NULL,
+		*decided_count > 0 ? (*decided)[0].length : 0);
+}
+
+void channel_end_slot(LinkModel* link, int outcome, int decided_count) {
+	if (!link_enabled(link) || decided_count == 0) {
+		return;
+	}
+	double airtime = link->busy_until - link->busy_from;
+	link->airtime_ms += airtime;
+	if (outcome == SLOT_DELIVERED) {
+		link->delivered_ms += airtime;
+	}
+	link->last_ms = link->busy_until;
+	link_clear(link);
+}
+
+int channel_resolve_slot(int frame_count, const char* frame, int length) {
+	if (frame_count == 0) {
+		return SLOT_IDLE;
+	}
+	if (frame_count > 1) {
+		return SLOT_COLLISION;
+	}
+	// A damaged frame is never delivered - the senders see noise and retransmit
+	return is_frame_corrupt(frame, length) ? SLOT_CORRUPT : SLOT_DELIVERED;
+}
+
+bool is_frame_corrupt(const char* buffer, int length) {
+	if (!(frame_wire_type(buffer) & FRAME_FLAG_CRC)) {
+		return false;
+	}
+	int covered = FRAME_HEADER_SIZE + frame_wire_length(buffer);
+	if (covered + CRC32C_SIZE > length) {
+		return true;    // Cut short, the trailer it claims is missing
+	}
+
+	return crc32c(0, buffer, covered) != wire_get_u32(buffer + covered);
+}
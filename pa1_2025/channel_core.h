@@ -0,0 +1,69 @@
+// channel_core.h - slot decision of the channel (link model and outcome), shared with the
+// trace replay tool
+#ifndef CHANNEL_CORE_H
+#define CHANNEL_CORE_H
+
+#include <stdbool.h>
+
+// What the channel does with a slot
+#define SLOT_IDLE -1             // Nothing arrived
+#define SLOT_DELIVERED 0         // One frame, broadcast to all stations
+#define SLOT_COLLISION 1         // Several frames, noise broadcast
+#define SLOT_CORRUPT 2           // One frame that failed its CRC check, noise broadcast
+
+// A frame taken from a station in a slot
+typedef struct {
+	char* buffer;
+	int length;
+	double arrival_ms;      // now_ms() of the channel loop iteration that took it
+	void* sender;           // The caller's handle for the sending station, may be NULL
+} ReceivedFrame;
+
+// Link model (-link-rate, -prop-delay). A frame occupies the medium from its arrival
+// for its length at the link rate plus the propagation delay, and frames whose times
+// on the medium overlap collide. The outcome is broadcast once the medium is quiet.
+typedef struct {
+	double rate_bps;        // Bits per second, 0 for no transmission time
+	double propagation_ms;
+	ReceivedFrame* frames;  // Frames on the medium, outcome not decided yet
+	int count;
+	int capacity;
+	double busy_from;       // Time at which the first of them arrived
+	double busy_until;      // Time at which the last of them has left the medium
+	double first_ms;        // First and last time the medium carried anything
+	double last_ms;
+	double airtime_ms;      // Time the medium carried frames
+	double delivered_ms;    // Part of it carrying frames delivered without a collision
+} LinkModel;
+
+bool link_enabled(const LinkModel* link);
+double link_airtime_ms(const LinkModel* link, int length);
+
+// Puts frames on the medium at their arrival times. The link takes over their buffers
+// (freed here if they cannot be kept).
+bool link_add_frames(LinkModel* link, ReceivedFrame* frames, int count);
+
+// Frees the frames on the medium
+void link_clear(LinkModel* link);
+
+// Decides a slot at `now` (same clock as the arrival times). Without the link model
+// the *count frames taken in the slot are decided. With it they go on the medium,
+// which takes over their buffers and sets *count to 0, and the frames on the medium
+// are decided once it is quiet at `now`. *decided and *decided_count receive the
+// frames whose outcome is returned (none and SLOT_IDLE while the medium is busy).
+int channel_decide_slot(LinkModel* link, ReceivedFrame* frames, int* count, double now,
+	ReceivedFrame** decided, int* decided_count);
+
+// Ends a slot decided by channel_decide_slot once its outcome is broadcast: with the
+// link model, adds up the medium's busy time and frees the decided frames
+void channel_end_slot(LinkModel* link, int outcome, int decided_count);
+
+// Decides the outcome of a slot in which frame_count frames arrived. frame and length
+// are the first of them (only looked at when it is the only one).
+int channel_resolve_slot(int frame_count, const char* frame, int length);
+
+// Checks a frame's CRC-32C trailer. Frames sent without one pass; a frame whose flagged
+// trailer is not within `length` bytes is corrupt.
+bool is_frame_corrupt(const char* buffer, int length);
+
+#endif
@@ -0,0 +1,143 @@
+// crc32c.c - CRC-32C (Castagnoli) with SSE4.2 acceleration and a table-driven fallback
+#include <string.h>
+#include "crc32c.h"
+#include "platform.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRC32C_TARGET
+#else
+#include <cpuid.h>
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#endif
+
+#define CRC32C_POLY 0x82F63B78  // Reflected Castagnoli polynomial
+
+static uint32_t crc_table[8][256];  // Slicing-by-8 tables
+static PlatformOnce crc_table_once = PLATFORM_ONCE_INIT;
+#ifdef CRC32C_X86
+static int hw_state = 0;            // 1 = SSE4.2, set once by crc32c_probe_hw()
+static PlatformOnce hw_once = PLATFORM_ONCE_INIT;
+#endif
+
+// Function to build the slicing-by-8 tables on first use (the read-ahead thread and
+// the event loops may get there at the same time)
+static void crc32c_init_tables(void) {
+	for (int i = 0; i < 256; i++) {
+		uint32_t c = (uint32_t)i;
+		for (int bit = 0; bit < 8; bit++) {
+			c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+		}
+		crc_table[0][i] = c;
+	}
+	for (int i = 0; i < 256; i++) {
+		for (int s = 1; s < 8; s++) {
+			crc_table[s][i] = (crc_table[s - 1][i] >> 8) ^ crc_table[0][crc_table[s - 1][i] & 0xFF];
+		}
+	}
+}
+
+// Little-endian 32-bit load at any alignment. Built from bytes, so the slicing tables
+// see the same words on any host; compilers turn it into one load where that matches.
+static uint32_t crc32c_load_le32(const uint8_t* p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t crc32c_sw(uint32_t crc, const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+
+	platform_once(&crc_table_once, crc32c_init_tables);
+
+	crc = ~crc;
+	while (length > 0 && ((uintptr_t)p & 7)) {
+		crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		length--;
+	}
+	// 8 bytes per step
+	while (length >= 8) {
+		uint32_t lo = crc32c_load_le32(p) ^ crc;
+		uint32_t hi = crc32c_load_le32(p + 4);
+		crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+			crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+			crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+			crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+		p += 8;
+		length -= 8;
+	}
+	while (length > 0) {
+		crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		length--;
+	}
+	return ~crc;
+}
+
+#ifdef CRC32C_X86
+CRC32C_TARGET uint32_t crc32c_hw(uint32_t crc, const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+
+	crc = ~crc;
+	while (length > 0 && ((uintptr_t)p & 7)) {
+		crc = _mm_crc32_u8(crc, *p++);
+		length--;
+	}
+#if defined(_M_X64) || defined(__x86_64__)
+	uint64_t crc64 = crc;
+	while (length >= 8) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		crc64 = _mm_crc32_u64(crc64, v);
+		p += 8;
+		length -= 8;
+	}
+	crc = (uint32_t)crc64;
+#endif
+	while (length >= 4) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		crc = _mm_crc32_u32(crc, v);
+		p += 4;
+		length -= 4;
+	}
+	while (length > 0) {
+		crc = _mm_crc32_u8(crc, *p++);
+		length--;
+	}
+	return ~crc;
+}
+
+// Function to check the CPU for SSE4.2: CPUID leaf 1, ECX bit 20
+static void crc32c_probe_hw(void) {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	hw_state = (info[2] >> 20) & 1;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	hw_state = __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? (int)((ecx >> 20) & 1) : 0;
+#endif
+}
+
+bool crc32c_hw_available(void) {
+	platform_once(&hw_once, crc32c_probe_hw);
+	return hw_state == 1;
+}
+#else
+uint32_t crc32c_hw(uint32_t crc, const void* data, size_t length) {
+	return crc32c_sw(crc, data, length);
+}
+
+bool crc32c_hw_available(void) {
+	return false;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+	if (crc32c_hw_available()) {
+		return crc32c_hw(crc, data, length);
+	}
+	return crc32c_sw(crc, data, length);
+}
@@ -0,0 +1,21 @@
+// crc32c.h - CRC-32C (Castagnoli) with SSE4.2 acceleration and a table-driven fallback
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CRC32C_SIZE 4            // Bytes in a frame's CRC trailer
+
+// Returns the CRC-32C of data, continuing from crc (pass 0 to start a new checksum).
+// Uses the SSE4.2 crc32 instruction when the CPU has it.
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+// The two implementations behind crc32c(), exposed for benchmarking.
+// crc32c_hw() may only be called if crc32c_hw_available() returns true.
+uint32_t crc32c_sw(uint32_t crc, const void* data, size_t length);
+uint32_t crc32c_hw(uint32_t crc, const void* data, size_t length);
+bool crc32c_hw_available(void);
+
+#endif
@@ -0,0 +1,165 @@
+// fec.c - systematic Reed-Solomon erasure code over GF(2^8) (Cauchy parity matrix)
+#include <string.h>
+#include "fec.h"
+#include "platform.h"
+
+#define GF_POLY 0x11D           // x^8 + x^4 + x^3 + x^2 + 1
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static uint8_t gf_mul_table[256][256];
+static PlatformOnce gf_once = PLATFORM_ONCE_INIT;
+
+// Function to build the log/exp and full multiplication tables, once (see gf_init)
+static void gf_build_tables(void) {
+	int x = 1;
+
+	for (int i = 0; i < 255; i++) {
+		gf_exp[i] = (uint8_t)x;
+		gf_log[x] = (uint8_t)i;
+		x <<= 1;
+		if (x & 0x100) {
+			x ^= GF_POLY;
+		}
+	}
+	for (int i = 255; i < 512; i++) {
+		gf_exp[i] = gf_exp[i - 255];
+	}
+
+	for (int a = 0; a < 256; a++) {
+		for (int b = 0; b < 256; b++) {
+			gf_mul_table[a][b] = (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+		}
+	}
+}
+
+// Function to make sure the tables are built; the read-ahead thread and the event loops
+// may get here at the same time
+static void gf_init(void) {
+	platform_once(&gf_once, gf_build_tables);
+}
+
+static uint8_t gf_inv(uint8_t a) {
+	return gf_exp[255 - gf_log[a]];
+}
+
+// Parity row j, data column i of the Cauchy matrix: 1 / (x_j + y_i), x_j = k + j, y_i = i
+static uint8_t cauchy_coef(int k, int j, int i) {
+	return gf_inv((uint8_t)((k + j) ^ i));
+}
+
+// dst ^= coef * src, byte by byte
+static void gf_mul_add(uint8_t* dst, const uint8_t* src, uint8_t coef, int len) {
+	const uint8_t* row = gf_mul_table[coef];
+
+	if (coef == 0) {
+		return;
+	}
+	if (coef == 1) {
+		for (int n = 0; n < len; n++) {
+			dst[n] ^= src[n];
+		}
+		return;
+	}
+	for (int n = 0; n < len; n++) {
+		dst[n] ^= row[src[n]];
+	}
+}
+
+void fec_encode_parity(int k, int parity_index, const uint8_t* const* data, uint8_t* parity, int shard_len) {
+	gf_init();
+
+	memset(parity, 0, shard_len);
+	for (int i = 0; i < k; i++) {
+		gf_mul_add(parity, data[i], cauchy_coef(k, parity_index, i), shard_len);
+	}
+}
+
+int fec_reconstruct(int k, int m, uint8_t** shards, const bool* present, int shard_len) {
+	uint8_t matrix[FEC_MAX_SHARDS][FEC_MAX_SHARDS];
+	uint8_t inverse[FEC_MAX_SHARDS][FEC_MAX_SHARDS];
+	int rows[FEC_MAX_SHARDS];    // Shard used for each row of the matrix
+	int used = 0;
+	int missing = 0;
+
+	if (k <= 0 || m < 0 || k + m > FEC_MAX_SHARDS) {
+		return -1;
+	}
+	gf_init();
+
+	// Take every data shard we have, then fill up with parity shards
+	for (int i = 0; i < k + m && used < k; i++) {
+		if (present[i]) {
+			rows[used++] = i;
+		}
+	}
+	if (used < k) {
+		return -1;
+	}
+	for (int i = 0; i < k; i++) {
+		missing += !present[i];
+	}
+	if (missing == 0) {
+		return 0;
+	}
+
+	// Rows of the generator matrix for the shards we are using
+	for (int r = 0; r < k; r++) {
+		for (int c = 0; c < k; c++) {
+			if (rows[r] < k) {
+				matrix[r][c] = (uint8_t)(rows[r] == c);
+			}
+			else {
+				matrix[r][c] = cauchy_coef(k, rows[r] - k, c);
+			}
+			inverse[r][c] = (uint8_t)(r == c);
+		}
+	}
+
+	// Gauss-Jordan elimination; any k rows of [I; Cauchy] are independent
+	for (int c = 0; c < k; c++) {
+		int pivot = c;
+		while (pivot < k && matrix[pivot][c] == 0) {
+			pivot++;
+		}
+		if (pivot == k) {
+			return -1;
+		}
+		if (pivot != c) {
+			for (int n = 0; n < k; n++) {
+				uint8_t t = matrix[c][n]; matrix[c][n] = matrix[pivot][n]; matrix[pivot][n] = t;
+				t = inverse[c][n]; inverse[c][n] = inverse[pivot][n]; inverse[pivot][n] = t;
+			}
+		}
+
+		uint8_t scale = gf_inv(matrix[c][c]);
+		for (int n = 0; n < k; n++) {
+			matrix[c][n] = gf_mul_table[scale][matrix[c][n]];
+			inverse[c][n] = gf_mul_table[scale][inverse[c][n]];
+		}
+
+		for (int r = 0; r < k; r++) {
+			uint8_t factor = matrix[r][c];
+			if (r == c || factor == 0) {
+				continue;
+			}
+			for (int n = 0; n < k; n++) {
+				matrix[r][n] ^= gf_mul_table[factor][matrix[c][n]];
+				inverse[r][n] ^= gf_mul_table[factor][inverse[c][n]];
+			}
+		}
+	}
+
+	// Missing data shard i = row i of the inverse applied to the shards we have
+	for (int i = 0; i < k; i++) {
+		if (present[i]) {
+			continue;
+		}
+		memset(shards[i], 0, shard_len);
+		for (int r = 0; r < k; r++) {
+			gf_mul_add(shards[i], shards[rows[r]], inverse[i][r], shard_len);
+		}
+	}
+
+	return missing;
+}
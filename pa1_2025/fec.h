@@ -0,0 +1,20 @@
+// fec.h - systematic Reed-Solomon erasure code over GF(2^8) (Cauchy parity matrix)
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FEC_MAX_SHARDS 64       // Data + parity shards per group (delivery is tracked in a 64-bit mask)
+
+// Computes parity shard `parity_index` (0..m-1) of a group of k data shards.
+// Every shard is shard_len bytes.
+void fec_encode_parity(int k, int parity_index, const uint8_t* const* data, uint8_t* parity, int shard_len);
+
+// Reconstructs the missing data shards of a group in place. shards[0..k-1] are the data
+// shards and shards[k..k+m-1] the parity shards; present[i] tells which ones were
+// received. Missing data shards must point to writable buffers of shard_len bytes.
+// Returns the number of data shards rebuilt, or -1 if fewer than k shards are present.
+int fec_reconstruct(int k, int m, uint8_t** shards, const bool* present, int shard_len);
+
+#endif
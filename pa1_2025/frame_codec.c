@@ -0,0 +1,54 @@
+// frame_codec.c - wire encoding of frame headers: fixed offsets, multi-byte fields in
+// network byte order, and echo matching on the encoded bytes
+#include "frame_codec.h"
+
+void frame_header_encode(const FrameHeader* header, void* wire) {
+	uint8_t* b = (uint8_t*)wire;
+
+	memcpy(b + FRAME_OFFSET_SRC_MAC, header->src_mac, 6);
+	memcpy(b + FRAME_OFFSET_DST_MAC, header->dst_mac, 6);
+	wire_put_u16(b + FRAME_OFFSET_TYPE, header->type);
+	wire_put_u32(b + FRAME_OFFSET_SEQ_NUM, header->seq_num);
+	wire_put_u16(b + FRAME_OFFSET_LENGTH, header->length);
+}
+
+void frame_header_decode(const void* wire, FrameHeader* header) {
+	const uint8_t* b = (const uint8_t*)wire;
+
+	memcpy(header->src_mac, b + FRAME_OFFSET_SRC_MAC, 6);
+	memcpy(header->dst_mac, b + FRAME_OFFSET_DST_MAC, 6);
+	header->type = wire_get_u16(b + FRAME_OFFSET_TYPE);
+	header->seq_num = wire_get_u32(b + FRAME_OFFSET_SEQ_NUM);
+	header->length = wire_get_u16(b + FRAME_OFFSET_LENGTH);
+}
+
+void fec_header_encode(const FecHeader* fec, void* wire) {
+	uint8_t* b = (uint8_t*)wire;
+
+	wire_put_u32(b, fec->group);
+	b[4] = fec->index;
+	b[5] = fec->k;
+	b[6] = fec->m;
+	b[7] = 0;
+	wire_put_u16(b + 8, fec->shard_len);
+}
+
+void fec_header_decode(const void* wire, FecHeader* fec) {
+	const uint8_t* b = (const uint8_t*)wire;
+
+	fec->group = wire_get_u32(b);
+	fec->index = b[4];
+	fec->k = b[5];
+	fec->m = b[6];
+	fec->shard_len = wire_get_u16(b + 8);
+}
+
+void frame_echo_key(const void* wire, FrameEchoKey* key) {
+	// The mask is built in memory order, so it keeps bytes 0..5 on any host
+	static const uint8_t mask_bytes[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00 };
+
+	memcpy(&key->head_mask, mask_bytes, sizeof(key->head_mask));
+	memcpy(&key->head, wire, sizeof(key->head));
+	key->head &= key->head_mask;
+	memcpy(&key->tail, (const uint8_t*)wire + FRAME_OFFSET_TYPE, sizeof(key->tail));
+}
@@ -0,0 +1,142 @@
+// frame_codec.h - wire encoding of frame headers: fixed offsets, multi-byte fields in
+// network byte order, and echo matching on the encoded bytes
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+// Encoded frame header: [src MAC 6][dst MAC 6][type 2][seq_num 4][length 2]
+#define FRAME_HEADER_SIZE 20
+#define FRAME_OFFSET_SRC_MAC 0
+#define FRAME_OFFSET_DST_MAC 6
+#define FRAME_OFFSET_TYPE 12
+#define FRAME_OFFSET_SEQ_NUM 14
+#define FRAME_OFFSET_LENGTH 18
+
+// Frame types, in the low byte of the type field
+#define FRAME_TYPE_DATA 0
+#define FRAME_TYPE_PARITY 1      // FEC parity frame, see FecHeader
+#define FRAME_TYPE_NOISE 2       // Broadcast by the channel for a collision or a corrupt frame
+#define FRAME_TYPE_DEFER 3       // Sent to one station: its frame is over the rate limit, retry later
+#define FRAME_TYPE_MASK 0x00FF
+
+// Type flags, in the high byte of the type field
+#define FRAME_FLAG_COMPRESSED 0x0100 // Payload is [original length, big-endian 16 bits][LZ block]
+#define FRAME_FLAG_FEC 0x0200    // Payload starts with an FecHeader
+#define FRAME_FLAG_CRC 0x0400    // CRC-32C of header + payload follows the payload
+
+// Body of a FRAME_TYPE_DEFER frame: [retry after, ms, big-endian 16 bits]
+#define DEFER_BODY_SIZE 2
+
+// Encoded FEC header, follows the frame header when FRAME_FLAG_FEC is set:
+// [group 4][index 1][k 1][m 1][reserved 1][shard_len 2]
+#define FEC_HEADER_SIZE 10
+
+// Decoded frame header, in host byte order. Frames on the wire are never accessed
+// through this struct - use frame_header_decode() / frame_header_encode().
+typedef struct {
+	uint8_t src_mac[6];
+	uint8_t dst_mac[6];
+	uint16_t type;          // Frame type in the low byte, FRAME_FLAG_* bits in the high byte
+	uint32_t seq_num;
+	uint16_t length;        // Bytes after the header, up to the CRC trailer
+} FrameHeader;
+
+// Decoded FEC header. A group is k data frames (frames group * k .. group * k + k - 1)
+// followed by m parity frames; any k of them rebuild the group.
+typedef struct {
+	uint32_t group;
+	uint8_t index;          // 0..k-1 data frame, k..k+m-1 parity frame
+	uint8_t k;              // Data frames in this group (the last group may be short)
+	uint8_t m;              // Parity frames per group
+	uint16_t shard_len;     // Parity frames: bytes of parity after this header, 0 in data frames
+} FecHeader;
+
+// The bytes an echo of our frame must repeat: source MAC, type, sequence number and
+// length (the destination MAC is not compared). Matching a received header takes two
+// 8-byte loads compared against the key.
+typedef struct {
+	uint64_t head;          // Bytes 0..7 of our encoded header, destination bytes cleared
+	uint64_t head_mask;     // Keeps bytes 0..5 (source MAC) of a loaded word
+	uint64_t tail;          // Bytes 12..19 (type, seq_num, length)
+} FrameEchoKey;
+
+// Compile-time checks of the layout the offsets above describe
+#define FRAME_CODEC_ASSERT(cond, name) typedef char frame_codec_assert_##name[(cond) ? 1 : -1]
+FRAME_CODEC_ASSERT(FRAME_OFFSET_DST_MAC == FRAME_OFFSET_SRC_MAC + 6, dst_follows_src);
+FRAME_CODEC_ASSERT(FRAME_OFFSET_TYPE == FRAME_OFFSET_DST_MAC + 6, type_follows_dst);
+FRAME_CODEC_ASSERT(FRAME_OFFSET_SEQ_NUM == FRAME_OFFSET_TYPE + sizeof(uint16_t), seq_follows_type);
+FRAME_CODEC_ASSERT(FRAME_OFFSET_LENGTH == FRAME_OFFSET_SEQ_NUM + sizeof(uint32_t), length_follows_seq);
+FRAME_CODEC_ASSERT(FRAME_HEADER_SIZE == FRAME_OFFSET_LENGTH + sizeof(uint16_t), header_size);
+FRAME_CODEC_ASSERT(FRAME_HEADER_SIZE - FRAME_OFFSET_TYPE == sizeof(uint64_t), tail_is_one_load);
+FRAME_CODEC_ASSERT(sizeof(((FrameHeader*)0)->type) == 2 && sizeof(((FrameHeader*)0)->seq_num) == 4 &&
+	sizeof(((FrameHeader*)0)->length) == 2, header_field_widths);
+
+// Big-endian loads and stores at any alignment
+static __inline uint16_t wire_get_u16(const void* p) {
+	const uint8_t* b = (const uint8_t*)p;
+	return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static __inline uint32_t wire_get_u32(const void* p) {
+	const uint8_t* b = (const uint8_t*)p;
+	return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static __inline void wire_put_u16(void* p, uint16_t value) {
+	uint8_t* b = (uint8_t*)p;
+	b[0] = (uint8_t)(value >> 8);
+	b[1] = (uint8_t)value;
+}
+
+static __inline void wire_put_u32(void* p, uint32_t value) {
+	uint8_t* b = (uint8_t*)p;
+	b[0] = (uint8_t)(value >> 24);
+	b[1] = (uint8_t)(value >> 16);
+	b[2] = (uint8_t)(value >> 8);
+	b[3] = (uint8_t)value;
+}
+
+// Single fields of an encoded header, for code that needs only one of them
+static __inline uint16_t frame_wire_type(const void* wire) {
+	return wire_get_u16((const uint8_t*)wire + FRAME_OFFSET_TYPE);
+}
+
+static __inline uint16_t frame_wire_length(const void* wire) {
+	return wire_get_u16((const uint8_t*)wire + FRAME_OFFSET_LENGTH);
+}
+
+// Bytes the frame at `wire` takes on the wire: header, payload and the CRC trailer if
+// flagged. Frames are sent without padding, so the next frame of a stream starts here.
+static __inline int frame_wire_size(const void* wire) {
+	return FRAME_HEADER_SIZE + frame_wire_length(wire) +
+		((frame_wire_type(wire) & FRAME_FLAG_CRC) ? CRC32C_SIZE : 0);
+}
+
+// Largest frame_wire_size() of any frame
+#define FRAME_MAX_WIRE_SIZE (FRAME_HEADER_SIZE + 0xFFFF + CRC32C_SIZE)
+
+void frame_header_encode(const FrameHeader* header, void* wire);
+void frame_header_decode(const void* wire, FrameHeader* header);
+void fec_header_encode(const FecHeader* fec, void* wire);
+void fec_header_decode(const void* wire, FecHeader* fec);
+
+// Builds the echo key of an encoded header
+void frame_echo_key(const void* wire, FrameEchoKey* key);
+
+// Checks whether the encoded header at `wire` (FRAME_HEADER_SIZE readable bytes) is an
+// echo of the frame the key was built from
+static __inline bool frame_echo_matches(const FrameEchoKey* key, const void* wire) {
+	uint64_t head;
+	uint64_t tail;
+
+	memcpy(&head, wire, sizeof(head));
+	memcpy(&tail, (const uint8_t*)wire + FRAME_OFFSET_TYPE, sizeof(tail));
+	return (((head & key->head_mask) ^ key->head) | (tail ^ key->tail)) == 0;
+}
+
+#endif
@@ -0,0 +1,198 @@
+// lz.c - small self-contained LZ77 block compressor (LZ4 block format)
+#include <string.h>
+#include "lz.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5      // A block always ends with at least 5 literals
+#define LZ_MF_LIMIT 12          // No match may start in the last 12 bytes
+#define LZ_MAX_OFFSET 65535
+#define LZ_SKIP_TRIGGER 6       // Step grows after 2^6 failed searches (incompressible data)
+
+static uint32_t lz_read32(const uint8_t* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t lz_hash(uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Writes the continuation bytes of a literal or match length (after the token nibble)
+static uint8_t* lz_put_length(uint8_t* op, int len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+// Worst-case bytes needed to emit lit_len literals plus the token and length bytes
+static int lz_literal_cost(int lit_len) {
+	return 1 + lit_len + (lit_len + 240) / 255;
+}
+
+int lz_compress(const uint8_t* src, int src_len, uint8_t* dst, int dst_capacity) {
+	int32_t table[1 << LZ_HASH_BITS];
+	const uint8_t* ip = src;
+	const uint8_t* anchor = src;
+	const uint8_t* iend = src + src_len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_capacity;
+
+	if (src_len < 0 || dst_capacity <= 0) {
+		return 0;
+	}
+
+	memset(table, 0xFF, sizeof(table));  // Every entry starts at -1 (no position)
+
+	if (src_len > LZ_MF_LIMIT) {
+		const uint8_t* mflimit = iend - LZ_MF_LIMIT;
+		const uint8_t* matchlimit = iend - LZ_LAST_LITERALS;
+		int searches = 1 << LZ_SKIP_TRIGGER;
+
+		while (ip < mflimit) {
+			uint32_t seq = lz_read32(ip);
+			uint32_t h = lz_hash(seq);
+			int32_t ref = table[h];
+			table[h] = (int32_t)(ip - src);
+
+			if (ref < 0 || (ip - src) - ref > LZ_MAX_OFFSET || lz_read32(src + ref) != seq) {
+				ip += searches++ >> LZ_SKIP_TRIGGER;
+				continue;
+			}
+			searches = 1 << LZ_SKIP_TRIGGER;
+
+			// Extend the match forward
+			const uint8_t* match = src + ref;
+			const uint8_t* p = ip + LZ_MIN_MATCH;
+			const uint8_t* m = match + LZ_MIN_MATCH;
+			while (p < matchlimit && *p == *m) {
+				p++;
+				m++;
+			}
+
+			int lit_len = (int)(ip - anchor);
+			int match_len = (int)(p - ip) - LZ_MIN_MATCH;
+			if (op + lz_literal_cost(lit_len) + 2 + match_len / 255 + 1 > oend) {
+				return 0;
+			}
+
+			// Sequence: token, literal length, literals, offset, match length
+			uint8_t* token = op++;
+			*token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+			if (lit_len >= 15) {
+				op = lz_put_length(op, lit_len - 15);
+			}
+			memcpy(op, anchor, lit_len);
+			op += lit_len;
+
+			uint16_t offset = (uint16_t)(ip - match);
+			*op++ = (uint8_t)(offset & 0xFF);
+			*op++ = (uint8_t)(offset >> 8);
+
+			*token |= (uint8_t)(match_len >= 15 ? 15 : match_len);
+			if (match_len >= 15) {
+				op = lz_put_length(op, match_len - 15);
+			}
+
+			ip = p;
+			anchor = ip;
+
+			// Index a position inside the match so the next one can chain to it
+			if (ip - 2 < mflimit) {
+				table[lz_hash(lz_read32(ip - 2))] = (int32_t)(ip - 2 - src);
+			}
+		}
+	}
+
+	// Remaining bytes go out as the final literal run
+	int lit_len = (int)(iend - anchor);
+	if (op + lz_literal_cost(lit_len) > oend) {
+		return 0;
+	}
+	*op++ = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+	if (lit_len >= 15) {
+		op = lz_put_length(op, lit_len - 15);
+	}
+	memcpy(op, anchor, lit_len);
+	op += lit_len;
+
+	return (int)(op - dst);
+}
+
+int lz_decompress(const uint8_t* src, int src_len, uint8_t* dst, int dst_capacity) {
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_capacity;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+
+		// Literals
+		int lit_len = token >> 4;
+		if (lit_len == 15) {
+			uint8_t b;
+			do {
+				if (ip >= iend) {
+					return -1;
+				}
+				b = *ip++;
+				lit_len += b;
+			} while (b == 255);
+		}
+		if (lit_len > iend - ip || lit_len > oend - op) {
+			return -1;
+		}
+		memcpy(op, ip, lit_len);
+		op += lit_len;
+		ip += lit_len;
+
+		if (ip == iend) {
+			break;  // The last sequence has no match
+		}
+
+		// Match
+		if (iend - ip < 2) {
+			return -1;
+		}
+		int offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op - dst) {
+			return -1;
+		}
+
+		int match_len = token & 15;
+		if (match_len == 15) {
+			uint8_t b;
+			do {
+				if (ip >= iend) {
+					return -1;
+				}
+				b = *ip++;
+				match_len += b;
+			} while (b == 255);
+		}
+		match_len += LZ_MIN_MATCH;
+		if (match_len > oend - op) {
+			return -1;
+		}
+
+		// Byte-wise copy: the match may overlap the bytes it produces
+		const uint8_t* match = op - offset;
+		if (offset >= match_len) {
+			memcpy(op, match, match_len);
+			op += match_len;
+		}
+		else {
+			for (int i = 0; i < match_len; i++) {
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return (int)(op - dst);
+}
@@ -0,0 +1,18 @@
+// lz.h - small self-contained LZ77 block compressor (LZ4 block format)
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+
+// Worst-case compressed size for an input of the given size
+#define LZ_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+
+// Compresses src into dst. Returns the compressed size, or 0 if the result would not
+// fit in dst_capacity (callers pass a capacity below src_len to only keep real savings).
+int lz_compress(const uint8_t* src, int src_len, uint8_t* dst, int dst_capacity);
+
+// Decompresses src into dst. Returns the decompressed size, or -1 if the input is
+// malformed or would overflow dst_capacity.
+int lz_decompress(const uint8_t* src, int src_len, uint8_t* dst, int dst_capacity);
+
+#endif
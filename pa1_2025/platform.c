@@ -0,0 +1,261 @@
+// platform.c - operating system services used by the channel, the sender and the tools
+#ifndef _WIN32
+#define _GNU_SOURCE              // ppoll()
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+
+#ifdef _WIN32
+
+#include <conio.h>  // For _kbhit() and _getch() functions
+#include <math.h>
+
+static volatile LONG shutdown_requested = 0;
+
+double now_ms(void) {
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
+int platform_poll(PlatformPollFd* fds, int count, double timeout_ms) {
+	// WSAPoll() rejects an empty set and only has a resolution of a millisecond
+	if (count == 0) {
+		if (timeout_ms > 0) {
+			Sleep((DWORD)ceil(timeout_ms));
+		}
+		return 0;
+	}
+	return WSAPoll(fds, (ULONG)count, (timeout_ms < 0) ? -1 : (INT)ceil(timeout_ms));
+}
+
+static BOOL CALLBACK once_callback(PINIT_ONCE once, PVOID fn, PVOID* context) {
+	(void)once;
+	(void)context;
+	((void (*)(void))fn)();
+	return TRUE;
+}
+
+void platform_once(PlatformOnce* once, void (*fn)(void)) {
+	InitOnceExecuteOnce(once, once_callback, (PVOID)fn, NULL);
+}
+
+// Console control handler: Ctrl+C, Ctrl+Break and closing the console window
+static BOOL WINAPI shutdown_handler(DWORD event) {
+	(void)event;
+	InterlockedExchange(&shutdown_requested, 1);
+	return TRUE;
+}
+
+void platform_catch_shutdown(void) {
+	SetConsoleCtrlHandler(shutdown_handler, TRUE);
+}
+
+bool platform_shutdown_requested(void) {
+	// Ctrl+Z (ASCII 26) is only seen as a key press
+	if (_kbhit()) {
+		int c = _getch();
+		if (c == 26 || c == 3) {
+			InterlockedExchange(&shutdown_requested, 1);
+		}
+	}
+	return shutdown_requested != 0;
+}
+
+bool platform_is_directory(const char* path) {
+	DWORD attributes = GetFileAttributesA(path);
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool platform_list_files(const char* dir, bool (*fn)(const char* path, void* arg), void* arg) {
+	char pattern[MAX_PATH];
+	char path[MAX_PATH];
+	WIN32_FIND_DATAA entry;
+
+	snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+	HANDLE find = FindFirstFileA(pattern, &entry);
+	if (find == INVALID_HANDLE_VALUE) {
+		return GetLastError() == ERROR_FILE_NOT_FOUND;    // Empty directory
+	}
+	do {
+		if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s\\%s", dir, entry.cFileName);
+		if (!fn(path, arg)) {
+			break;
+		}
+	} while (FindNextFileA(find, &entry));
+	FindClose(find);
+	return true;
+}
+
+#else
+
+#include <signal.h>
+#include <time.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+static volatile sig_atomic_t shutdown_requested = 0;
+
+// Thread started by CreateThread()
+typedef struct {
+	pthread_t thread;
+	LPTHREAD_START_ROUTINE start;
+	LPVOID arg;
+} PlatformThread;
+
+int WSAStartup(uint16_t version, WSADATA* data) {
+	(void)version;
+	(void)data;
+	signal(SIGPIPE, SIG_IGN);
+	return 0;
+}
+
+static void* thread_main(void* arg) {
+	PlatformThread* t = (PlatformThread*)arg;
+	t->start(t->arg);
+	return NULL;
+}
+
+HANDLE CreateThread(void* attributes, size_t stack_size, LPTHREAD_START_ROUTINE start, LPVOID arg,
+	DWORD flags, DWORD* thread_id) {
+	(void)attributes;
+	(void)stack_size;
+	(void)flags;
+	(void)thread_id;
+
+	PlatformThread* t = (PlatformThread*)malloc(sizeof(PlatformThread));
+	if (!t) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	t->start = start;
+	t->arg = arg;
+
+	int error = pthread_create(&t->thread, NULL, thread_main, t);
+	if (error != 0) {
+		free(t);
+		errno = error;
+		return NULL;
+	}
+	return t;
+}
+
+DWORD WaitForSingleObject(HANDLE thread, DWORD timeout_ms) {
+	(void)timeout_ms;    // Threads are only ever waited for until they end
+	pthread_join(((PlatformThread*)thread)->thread, NULL);
+	return 0;
+}
+
+BOOL CloseHandle(HANDLE thread) {
+	free(thread);
+	return TRUE;
+}
+
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* cond, CRITICAL_SECTION* lock, DWORD timeout_ms) {
+	if (timeout_ms == INFINITE) {
+		return pthread_cond_wait(cond, lock) == 0;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	return pthread_cond_timedwait(cond, lock, &deadline) == 0;
+}
+
+void Sleep(DWORD ms) {
+	struct timespec delay;
+
+	delay.tv_sec = ms / 1000;
+	delay.tv_nsec = (long)(ms % 1000) * 1000000L;
+	// Sleep the full time even if a signal arrives
+	while (nanosleep(&delay, &delay) == -1 && errno == EINTR) {
+	}
+}
+
+double now_ms(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+int platform_poll(PlatformPollFd* fds, int count, double timeout_ms) {
+	if (timeout_ms < 0) {
+		return poll(fds, (nfds_t)count, -1);
+	}
+
+	// ppoll() keeps the sub-millisecond waits of the link model
+	struct timespec timeout;
+	timeout.tv_sec = (time_t)(timeout_ms / 1000);
+	timeout.tv_nsec = (long)((timeout_ms - timeout.tv_sec * 1000.0) * 1000000.0);
+	return ppoll(fds, (nfds_t)count, &timeout, NULL);
+}
+
+void platform_once(PlatformOnce* once, void (*fn)(void)) {
+	pthread_once(once, fn);
+}
+
+static void shutdown_handler(int signal_number) {
+	(void)signal_number;
+	shutdown_requested = 1;
+}
+
+void platform_catch_shutdown(void) {
+	struct sigaction action;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = shutdown_handler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGTSTP, &action, NULL);   // Ctrl+Z ends the run, as in the Windows console
+}
+
+bool platform_shutdown_requested(void) {
+	return shutdown_requested != 0;
+}
+
+bool platform_is_directory(const char* path) {
+	struct stat info;
+	return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool platform_list_files(const char* dir, bool (*fn)(const char* path, void* arg), void* arg) {
+	char path[PATH_MAX];
+	struct stat info;
+
+	DIR* d = opendir(dir);
+	if (!d) {
+		return false;
+	}
+	struct dirent* entry;
+	while ((entry = readdir(d)) != NULL) {
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+			continue;    // Subdirectories, ".", ".." and anything else that is not a file
+		}
+		if (!fn(path, arg)) {
+			break;
+		}
+	}
+	closedir(d);
+	return true;
+}
+
+#endif
@@ -0,0 +1,203 @@
+// platform.h - operating system services used by the channel, the sender and the tools:
+// sockets, threads and locks, atomics, a monotonic clock, sleep and shutdown requests.
+// On Windows they come from Winsock and Win32. Elsewhere (Linux) the same Winsock/Win32
+// names are provided on top of POSIX, so the rest of the code is written once.
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+
+#ifndef _WINSOCK_DEPRECATED_NO_WARNINGS
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+#else
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Win32 base types, with the Windows sizes
+typedef int BOOL;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef void* LPVOID;
+typedef void* HANDLE;
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define INFINITE 0xFFFFFFFF
+
+// Sockets
+typedef int SOCKET;
+typedef struct {
+	int unused;
+} WSADATA;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define MAKEWORD(low, high) ((uint16_t)(((low) & 0xFF) | (((high) & 0xFF) << 8)))
+#define WSAEINTR EINTR
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define WSAEINPROGRESS EINPROGRESS
+#define WSAECONNREFUSED ECONNREFUSED
+#define WSAECONNRESET ECONNRESET
+#define WSAENETUNREACH ENETUNREACH
+#define WSAETIMEDOUT ETIMEDOUT
+
+// Nothing to start on POSIX, except that a send to a closed connection must fail with
+// an error (as on Winsock) instead of raising SIGPIPE
+int WSAStartup(uint16_t version, WSADATA* data);
+
+static inline int WSACleanup(void) {
+	return 0;
+}
+
+static inline int WSAGetLastError(void) {
+	return errno;
+}
+
+static inline DWORD GetLastError(void) {
+	return (DWORD)errno;
+}
+
+static inline int closesocket(SOCKET s) {
+	return close(s);
+}
+
+// FIONBIO and FIONREAD, with the u_long argument Winsock takes
+static inline int ioctlsocket(SOCKET s, unsigned long command, u_long* arg) {
+	int value = (int)*arg;
+	int result = ioctl(s, command, &value);
+	*arg = (u_long)value;
+	return result;
+}
+
+// Threads. The handle is only good for one WaitForSingleObject() and CloseHandle().
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID arg);
+HANDLE CreateThread(void* attributes, size_t stack_size, LPTHREAD_START_ROUTINE start, LPVOID arg,
+	DWORD flags, DWORD* thread_id);
+DWORD WaitForSingleObject(HANDLE thread, DWORD timeout_ms);
+BOOL CloseHandle(HANDLE thread);
+
+// Locks and condition variables
+typedef pthread_mutex_t CRITICAL_SECTION;
+typedef pthread_cond_t CONDITION_VARIABLE;
+
+static inline void InitializeCriticalSection(CRITICAL_SECTION* lock) {
+	pthread_mutex_init(lock, NULL);
+}
+
+static inline void DeleteCriticalSection(CRITICAL_SECTION* lock) {
+	pthread_mutex_destroy(lock);
+}
+
+static inline void EnterCriticalSection(CRITICAL_SECTION* lock) {
+	pthread_mutex_lock(lock);
+}
+
+static inline void LeaveCriticalSection(CRITICAL_SECTION* lock) {
+	pthread_mutex_unlock(lock);
+}
+
+static inline void InitializeConditionVariable(CONDITION_VARIABLE* cond) {
+	pthread_cond_init(cond, NULL);
+}
+
+static inline void WakeConditionVariable(CONDITION_VARIABLE* cond) {
+	pthread_cond_signal(cond);
+}
+
+static inline void WakeAllConditionVariable(CONDITION_VARIABLE* cond) {
+	pthread_cond_broadcast(cond);
+}
+
+// Returns FALSE if timeout_ms (not INFINITE) passed without a wake-up
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* cond, CRITICAL_SECTION* lock, DWORD timeout_ms);
+
+// Atomics, all full barriers as on Windows
+static inline LONG InterlockedIncrement(volatile LONG* target) {
+	return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedExchange(volatile LONG* target, LONG value) {
+	return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand) {
+	__atomic_compare_exchange_n(target, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+#define MemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor() __builtin_ia32_pause()
+#else
+#define YieldProcessor() __asm__ __volatile__("" ::: "memory")
+#endif
+
+void Sleep(DWORD ms);
+
+#endif
+
+// Waiting on sockets: poll() on POSIX, WSAPoll() on Windows. Unlike select() there is
+// no limit on the number of sockets or on their values.
+#ifdef _WIN32
+typedef WSAPOLLFD PlatformPollFd;
+#else
+#include <poll.h>
+typedef struct pollfd PlatformPollFd;
+#endif
+
+// Waits until one of the sockets has an event (POLLIN, POLLOUT, POLLHUP, POLLERR in
+// revents) or timeout_ms has passed - indefinitely if it is negative. Returns the number
+// of sockets with events, 0 on timeout and SOCKET_ERROR on failure (WSAEINTR when a
+// signal arrived).
+int platform_poll(PlatformPollFd* fds, int count, double timeout_ms);
+
+// One-time initialization: platform_once() runs fn the first time it is called with a
+// given flag, and every other caller waits until fn has returned
+#ifdef _WIN32
+typedef INIT_ONCE PlatformOnce;
+#define PLATFORM_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+typedef pthread_once_t PlatformOnce;
+#define PLATFORM_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+void platform_once(PlatformOnce* once, void (*fn)(void));
+
+// Monotonic clock in milliseconds, for timeouts and rates (not wall-clock time)
+double now_ms(void);
+
+// Routes the requests to stop - Ctrl+C, and on Linux SIGTERM and the Ctrl+Z of the
+// terminal (SIGTSTP) - to platform_shutdown_requested() instead of killing the process.
+// The Windows console's Ctrl+Z is read from the keyboard as before.
+void platform_catch_shutdown(void);
+
+// Returns true once a shutdown has been requested
+bool platform_shutdown_requested(void);
+
+// Returns true if path names a directory
+bool platform_is_directory(const char* path);
+
+// Calls fn with the path (directory + name) of every regular file in a directory, in
+// no particular order, until it returns false. Returns false if the directory cannot
+// be read.
+bool platform_list_files(const char* dir, bool (*fn)(const char* path, void* arg), void* arg);
+
+#endif
@@ -0,0 +1,400 @@
+// replay.c - replays a slot trace recorded by "channel -trace" through the channel's
+// slot decision (link model and outcome), as fast as possible or at the recorded pacing.
+// Frames are rebuilt with the CRC values the channel saw and handed over at the times
+// the channel took them, so the outcome is decided again rather than copied.
+// Build: cl /O2 replay.c channel_core.c crc32c.c frame_codec.c platform.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "channel_core.h"
+#include "crc32c.h"
+#include "frame_codec.h"
+#include "trace.h"
+
+#define PACING_SPIN_MS 2         // Below this the paced replay spins instead of sleeping
+
+#pragma pack(push, 1)
+typedef struct {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+} PcapFileHeader;
+
+typedef struct {
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint32_t incl_len;
+	uint32_t orig_len;
+} PcapRecordHeader;
+#pragma pack(pop)
+
+// A recorded slot with its frames rebuilt, ready to hand to the slot decision
+typedef struct {
+	TraceRecord record;
+	char* frames[TRACE_MAX_FRAMES];
+	int senders[TRACE_MAX_FRAMES];  // Index into the sender table
+} ReplaySlot;
+
+// Statistics per recorded sender (address and port of its connection)
+typedef struct {
+	uint32_t ip;
+	uint16_t port;
+	int frames;
+	int64_t bytes;
+	int delivered;
+	int collisions;
+	int corrupt;
+} Sender;
+
+// Function prototypes
+void wait_until(double target_ms);
+int find_sender(Sender** senders, int* sender_count, int* capacity, uint32_t ip, uint16_t port);
+char* rebuild_frame(const TraceFrame* entry);
+ReplaySlot* load_trace(const char* path, int* slot_count, Sender** senders, int* sender_count);
+void free_trace(ReplaySlot* slots, int slot_count);
+int replay_slot(LinkModel* link, const ReplaySlot* slot, int* decisions);
+
+// Function to wait for a point in time, sleeping while it is far and spinning when close
+void wait_until(double target_ms) {
+	for (;;) {
+		double left = target_ms - now_ms();
+		if (left <= 0) {
+			return;
+		}
+		if (left > PACING_SPIN_MS) {
+			Sleep((DWORD)(left - PACING_SPIN_MS + 1));
+		}
+	}
+}
+
+// Function to look up a sender, adding it on first sight. Returns its index or -1.
+int find_sender(Sender** senders, int* sender_count, int* capacity, uint32_t ip, uint16_t port) {
+	for (int i = 0; i < *sender_count; i++) {
+		if ((*senders)[i].ip == ip && (*senders)[i].port == port) {
+			return i;
+		}
+	}
+
+	if (*sender_count == *capacity) {
+		int new_capacity = *capacity ? *capacity * 2 : 16;
+		Sender* grown = (Sender*)realloc(*senders, new_capacity * sizeof(Sender));
+		if (!grown) {
+			return -1;
+		}
+		*senders = grown;
+		*capacity = new_capacity;
+	}
+
+	Sender* sender = &(*senders)[(*sender_count)++];
+	memset(sender, 0, sizeof(*sender));
+	sender->ip = ip;
+	sender->port = port;
+	return *sender_count - 1;
+}
+
+// Function to rebuild a recorded frame: the recorded header, a zero payload of the
+// recorded size and, for checksummed frames, a trailer that differs from the CRC of
+// the rebuilt frame exactly as the received trailer differed from the received frame's
+char* rebuild_frame(const TraceFrame* entry) {
+	int length = entry->bytes > TRACE_HEADER_BYTES ? entry->bytes : TRACE_HEADER_BYTES;
+	char* frame = (char*)calloc(length, 1);
+	if (!frame) {
+		return NULL;
+	}
+	memcpy(frame, entry->header, TRACE_HEADER_BYTES);
+
+	int covered = FRAME_HEADER_SIZE + frame_wire_length(frame);
+	if ((frame_wire_type(frame) & FRAME_FLAG_CRC) && covered + CRC32C_SIZE <= length) {
+		uint32_t crc = crc32c(0, frame, covered) ^ entry->crc_computed ^ entry->crc_trailer;
+		wire_put_u32(frame + covered, crc);
+	}
+
+	return frame;
+}
+
+// Function to load every record of a trace file and rebuild its frames up front, so
+// the replay loop only runs the slot decision
+ReplaySlot* load_trace(const char* path, int* slot_count, Sender** senders, int* sender_count) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "Cannot open trace file %s\n", path);
+		return NULL;
+	}
+
+	PcapFileHeader file_header;
+	if (fread(&file_header, sizeof(file_header), 1, fp) != 1 ||
+		file_header.magic != 0xA1B2C3D4 || file_header.network != TRACE_LINKTYPE) {
+		fprintf(stderr, "%s is not a channel slot trace\n", path);
+		fclose(fp);
+		return NULL;
+	}
+
+	ReplaySlot* slots = NULL;
+	int count = 0;
+	int capacity = 0;
+	int sender_capacity = 0;
+	bool ok = true;
+	PcapRecordHeader packet;
+
+	while (ok && fread(&packet, sizeof(packet), 1, fp) == 1) {
+		if (packet.incl_len != sizeof(TraceRecord)) {
+			fprintf(stderr, "Unexpected record size %u in %s\n", packet.incl_len, path);
+			ok = false;
+			break;
+		}
+		if (count == capacity) {
+			int new_capacity = capacity ? capacity * 2 : 1024;
+			ReplaySlot* grown = (ReplaySlot*)realloc(slots, new_capacity * sizeof(ReplaySlot));
+			if (!grown) {
+				fprintf(stderr, "Memory allocation failed for %d trace records\n", new_capacity);
+				ok = false;
+				break;
+			}
+			slots = grown;
+			capacity = new_capacity;
+		}
+
+		ReplaySlot* slot = &slots[count];
+		memset(slot->frames, 0, sizeof(slot->frames));
+		if (fread(&slot->record, sizeof(TraceRecord), 1, fp) != 1) {
+			break;  // Trace cut short while the channel was still writing it
+		}
+		count++;
+
+		TraceRecord* record = &slot->record;
+		if (record->frame_count > TRACE_MAX_FRAMES) {
+			record->frame_count = TRACE_MAX_FRAMES;
+		}
+		for (int i = 0; i < record->frame_count && ok; i++) {
+			slot->senders[i] = find_sender(senders, sender_count, &sender_capacity,
+				record->frames[i].sender_ip, record->frames[i].sender_port);
+			slot->frames[i] = rebuild_frame(&record->frames[i]);
+			if (slot->senders[i] < 0 || !slot->frames[i]) {
+				fprintf(stderr, "Memory allocation failed while loading %s\n", path);
+				ok = false;
+			}
+		}
+		if (record->frame_count == 0) {
+			fprintf(stderr, "Record for slot %u has no frames\n", record->slot);
+			ok = false;
+		}
+	}
+	fclose(fp);
+
+	if (!ok) {
+		free_trace(slots, count);
+		return NULL;
+	}
+	*slot_count = count;
+	return slots;
+}
+
+// Function to free the loaded trace
+void free_trace(ReplaySlot* slots, int slot_count) {
+	for (int i = 0; i < slot_count; i++) {
+		for (int f = 0; f < TRACE_MAX_FRAMES; f++) {
+			free(slots[i].frames[f]);
+		}
+	}
+	free(slots);
+}
+
+// Function to decide a recorded slot again with the channel's code. Frames taken in the
+// same channel loop iteration share an arrival time and are handed over together, then
+// the slot is decided at the recorded decision time. The buffers are copies, since the
+// link model frees what it takes. Returns the outcome; *decisions counts the outcomes
+// reached, 1 when the frames were decided together as recorded.
+// Only the first TRACE_MAX_FRAMES frames of a slot are recorded, so a larger collision
+// is replayed with those.
+int replay_slot(LinkModel* link, const ReplaySlot* slot, int* decisions) {
+	const TraceRecord* record = &slot->record;
+	ReceivedFrame group[TRACE_MAX_FRAMES];
+	int outcome = SLOT_IDLE;
+	int f = 0;
+	bool last = false;
+
+	*decisions = 0;
+	while (!last) {
+		last = (f == record->frame_count);
+		double now = last ? record->decided_ms : record->frames[f].arrival_ms;
+		int count = 0;
+		while (f < record->frame_count && record->frames[f].arrival_ms == now) {
+			int length = record->frames[f].bytes;
+			group[count].buffer = (char*)malloc(length);
+			if (!group[count].buffer) {
+				fprintf(stderr, "Memory allocation failed for a replayed frame\n");
+				f++;
+				continue;
+			}
+			memcpy(group[count].buffer, slot->frames[f], length);
+			group[count].length = length;
+			group[count].arrival_ms = now;
+			group[count].sender = NULL;
+			count++;
+			f++;
+		}
+
+		ReceivedFrame* decided;
+		int decided_count;
+		int result = channel_decide_slot(link, group, &count, now, &decided, &decided_count);
+		if (result != SLOT_IDLE) {
+			outcome = result;
+			(*decisions)++;
+		}
+		channel_end_slot(link, result, decided_count);
+		for (int i = 0; i < count; i++) {
+			free(group[i].buffer);
+		}
+	}
+
+	return outcome;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <trace_file> [options]\n", argv[0]);
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -paced               Replay at the recorded slot times instead of as fast as possible\n");
+		fprintf(stderr, "  -speed <factor>      Pacing speed-up, e.g. 2 replays twice as fast (implies -paced)\n");
+		fprintf(stderr, "  -repeat <count>      Replay the trace this many times (default 1)\n");
+		fprintf(stderr, "Exits with 2 if any slot is decided differently than it was when recorded.\n");
+		return 1;
+	}
+
+	const char* trace_file = argv[1];
+	bool paced = false;
+	double speed = 1.0;
+	int repeat = 1;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-paced") == 0) {
+			paced = true;
+		}
+		else if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc) {
+			speed = atof(argv[++i]);
+			paced = true;
+			if (speed <= 0) {
+				fprintf(stderr, "Speed must be positive\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc) {
+			repeat = atoi(argv[++i]);
+			if (repeat < 1) {
+				fprintf(stderr, "Repeat count must be at least 1\n");
+				return 1;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	Sender* senders = NULL;
+	int sender_count = 0;
+	int slot_count = 0;
+	ReplaySlot* slots = load_trace(trace_file, &slot_count, &senders, &sender_count);
+	if (!slots) {
+		free(senders);
+		return 1;
+	}
+	if (slot_count == 0) {
+		fprintf(stderr, "Trace %s has no records\n", trace_file);
+		free(senders);
+		return 1;
+	}
+
+	uint32_t first_slot = slots[0].record.slot;
+	uint32_t spanned_slots = slots[slot_count - 1].record.slot - first_slot + 1;
+	double recorded_ms = slots[slot_count - 1].record.decided_ms - slots[0].record.decided_ms;
+
+	int outcomes[3] = { 0, 0, 0 };
+	int mismatches = 0;
+	LinkModel link;
+	memset(&link, 0, sizeof(link));
+	double start_ms = now_ms();
+
+	for (int run = 0; run < repeat; run++) {
+		double run_start_ms = now_ms();
+
+		// Each run starts with a quiet medium and the link model of the recording
+		ReceivedFrame* link_frames = link.frames;
+		int link_capacity = link.capacity;
+		link_clear(&link);
+		memset(&link, 0, sizeof(link));
+		link.frames = link_frames;
+		link.capacity = link_capacity;
+		link.rate_bps = slots[0].record.link_rate_bps;
+		link.propagation_ms = slots[0].record.propagation_ms;
+
+		for (int i = 0; i < slot_count; i++) {
+			ReplaySlot* slot = &slots[i];
+			TraceRecord* record = &slot->record;
+
+			if (paced) {
+				wait_until(run_start_ms + (record->decided_ms - slots[0].record.decided_ms) / speed);
+			}
+
+			int decisions;
+			int outcome = replay_slot(&link, slot, &decisions);
+
+			// Statistics are taken from the first run, later runs only add timing
+			if (run > 0) {
+				continue;
+			}
+			if (outcome != record->outcome || decisions != 1) {
+				mismatches++;
+			}
+			if (outcome != SLOT_IDLE) {
+				outcomes[outcome]++;
+			}
+			for (int f = 0; f < record->frame_count; f++) {
+				Sender* sender = &senders[slot->senders[f]];
+				sender->frames++;
+				sender->bytes += record->frames[f].bytes;
+				sender->delivered += (outcome == SLOT_DELIVERED);
+				sender->collisions += (outcome == SLOT_COLLISION);
+				sender->corrupt += (outcome == SLOT_CORRUPT);
+			}
+		}
+	}
+
+	double elapsed_ms = now_ms() - start_ms;
+	int64_t replayed = (int64_t)slot_count * repeat;
+
+	printf("Trace %s: %d slots with traffic out of %u (%.1f ms recorded), %d senders\n",
+		trace_file, slot_count, spanned_slots, recorded_ms, sender_count);
+	if (paced) {
+		printf("Replay: paced at %.2fx, %d run(s) in %.1f ms\n", speed, repeat, elapsed_ms);
+	}
+	else {
+		printf("Replay: as fast as possible, %d run(s) in %.3f ms, %.0f slots/sec, %.1f ns/slot\n",
+			repeat, elapsed_ms, elapsed_ms > 0 ? replayed / (elapsed_ms / 1000.0) : 0,
+			replayed > 0 ? elapsed_ms * 1e6 / replayed : 0);
+	}
+	printf("Outcomes: %d delivered, %d collisions, %d corrupt, %d differ from the recording\n",
+		outcomes[SLOT_DELIVERED], outcomes[SLOT_COLLISION], outcomes[SLOT_CORRUPT], mismatches);
+	printf("Slot utilization: %.1f%% of slots delivered a frame, %.1f%% carried traffic\n",
+		100.0 * outcomes[SLOT_DELIVERED] / spanned_slots, 100.0 * slot_count / spanned_slots);
+
+	for (int i = 0; i < sender_count; i++) {
+		struct in_addr addr;
+		addr.s_addr = senders[i].ip;
+		printf("From %s port %d: %d frames, %lld bytes, %d delivered, %d collisions, %d corrupt\n",
+			inet_ntoa(addr), senders[i].port, senders[i].frames, (long long)senders[i].bytes,
+			senders[i].delivered, senders[i].collisions, senders[i].corrupt);
+	}
+
+	link_clear(&link);
+	free(link.frames);
+	free_trace(slots, slot_count);
+	free(senders);
+	return mismatches > 0 ? 2 : 0;
+}
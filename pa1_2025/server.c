@@ -1,64 +1,340 @@
-#define _WINSOCK_DEPRECATED_NO_WARNINGS
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <winsock2.h>
 #include <time.h>
 #include <stdbool.h>
-#include <conio.h>  // For _kbhit() and _getch() functions
-
-#pragma comment(lib, "Ws2_32.lib")
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "platform.h"
+#include "lz.h"
+#include "fec.h"
+#include "crc32c.h"
+#include "frame_codec.h"
 
 #define MAX_ATTEMPTS 10
-#define FRAME_TYPE_DATA 0
-#define FRAME_TYPE_NOISE 2
+#define COMPRESSED_PREFIX_SIZE 2  // Original length stored ahead of the compressed block
+#define FEC_SHARD_PREFIX_SIZE 4  // Body length and type (big-endian) stored ahead of each data shard
+#define FEC_RX_SOURCES 8         // Other stations whose FEC groups a station reassembles at once
 #define CONNECTION_RETRY_MS 1000  // Time between connection retry attempts
 #define MAX_CTRL_Z_WAIT_SEC 60     // Maximum time to wait for Ctrl+Z input in seconds
-#define MIN_FRAME_SIZE 20        // Minimum frame size to accommodate header
-
-#pragma pack(push, 1)
+#define MIN_FRAME_SIZE FRAME_HEADER_SIZE // Minimum frame size to accommodate header
+#define DEFAULT_READAHEAD_DEPTH 8 // Frames prepared ahead of the transmit loop
+#define MIN_RECV_BUFFER_SIZE 65536 // Room for new data in each read, after any partial frame
+#define MAX_PAYLOAD_SIZE 65535    // Largest payload the 16-bit length field can describe
+#define MAX_STATIONS 65535       // Station index must fit in the low bytes of the MAC
+#define STATIONS_PER_WORKER 64   // Stations serviced by one event loop thread
+#define READAHEAD_POLL_MS 1      // Event loop wake-up interval while a station waits for data
+#define CHECKPOINT_MAGIC 0x32504B43   // "CKP2"
+#define CHECKPOINT_READ_SIZE 16384    // Bytes read at a time for the acknowledged prefix's CRC
+#define MAX_RECONNECTS 10        // Reconnects per station before the transfer is abandoned
+#define BATCH_FILE_SHIFT 24      // Batch mode: file index (mod 256) in the top byte of seq_num and FEC group
+#define BATCH_MAX_FRAMES (1 << BATCH_FILE_SHIFT) // Frames of one file the low bits can number
+
+// A frame built by the read-ahead thread (header filled in, payload loaded)
+typedef struct {
+	char* data;             // Frame buffer, ready to send as-is
+	int frame_idx;
+	int payload_len;        // Bytes of file data in this frame
+	int wire_len;           // Bytes to send: header, payload and CRC trailer, no padding
+	int raw_wire_len;       // wire_len had the payload been sent uncompressed
+	bool compressed;
+	bool parity;            // FEC parity frame (frame_idx is the group's first frame)
+	int fec_group;
+	int fec_index;          // Shard index within the group
+	int fec_k;              // Data frames in the group
+	int file_idx;           // Batch file the frame belongs to (0 outside batch mode)
+	FrameEchoKey echo;      // Matches the echo of the header as sent
+} ReadyFrame;
+
+// One file of a batch transfer (-batch)
+typedef struct {
+	char name[260];
+	int file_size;          // Set by the read-ahead thread when it opens the file
+	int total_frames;
+	bool opened;
+	bool failed;            // Could not be opened or read, or not all frames acknowledged
+	bool done;              // All frames acknowledged
+	int transmissions;
+	double start_ms;        // First frame taken for transmission
+	double end_ms;          // Last frame acknowledged
+} BatchFile;
+
+// Files sent one after another over a station's single connection. The read-ahead
+// thread opens each file as soon as the frames of the one before are loaded, so
+// opening and reading stay ahead of the transmitter from one file to the next.
 typedef struct {
+	const char* source;     // Manifest or directory the list came from
+	BatchFile* files;
+	int file_count;
+	int capacity;
+	int next_open;          // Read-ahead thread: next file to open
+	int current;            // Transmitter: file being sent, -1 before the first frame
+	int frames_base;        // Station's frames_done when the current file started
+	int transmissions_base; // Station's total_transmissions when the current file started
+} Batch;
+
+// Ring of ready-to-send frames for one station, filled ahead of its transmit loop
+typedef struct {
+	FILE* fp;
+	ReadyFrame* slots;
+	int depth;              // Number of frames in the ring
+	int head;               // Next slot the transmitter will take
+	int count;              // Number of ready frames in the ring
+	int next_frame;         // Next frame index the producer will load
+	int total_frames;
+	int file_size;
+	int frame_size;         // Bytes sent per frame
+	int buffer_size;        // Bytes allocated per frame (header + payload)
+	int payload_size;       // Bytes of file data per full frame
 	uint8_t src_mac[6];
 	uint8_t dst_mac[6];
-	uint16_t type;        // 0 = data, 2 = noise
-	uint32_t seq_num;
-	uint16_t length;
-} FrameHeader;
-#pragma pack(pop)
+	bool compress;          // Try to compress each frame's payload
+	bool crc;               // Append a CRC-32C trailer to every frame
+	int fec_k;              // Data frames per FEC group, 0 when FEC is off
+	int fec_m;              // Parity frames per FEC group
+	int fec_group;          // Group of the data frames being loaded
+	int fec_parity_next;    // Next parity frame to build once a group is loaded, -1 if none
+	uint8_t* fec_shards;    // Data shards of the group being loaded (k * fec_shard_capacity)
+	int fec_shard_capacity;
+	int fec_shard_len;      // Longest shard of the group so far = parity frame size
+	int fec_raw_shard_len;  // Same, had the shards been sent uncompressed
+	Batch* batch;           // Batch mode: the files loaded one after another, NULL otherwise
+	int file_idx;           // Batch file being loaded
+	uint32_t seq_base;      // Sequence namespace of that file, added to seq_num and FEC group
+	bool exhausted;         // Batch mode: every file has been loaded
+	bool failed;            // Producer could not read the frame at next_frame
+	bool stalled;           // Transmitter is waiting on an empty ring
+	double stall_start;
+	int stalls;             // Times the transmitter had to wait for data
+	double stall_ms;        // Total time the transmitter spent waiting
+} FrameRing;
+
+// Producer thread shared by the rings of all stations
+typedef struct {
+	FrameRing** rings;
+	int ring_count;
+	int next_ring;          // Round-robin position of the producer
+	char* scratch;          // Raw payload staging buffer for compression
+	bool stop;              // Set by the transmitters to end the producer early
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE not_empty;
+	CONDITION_VARIABLE not_full;
+	HANDLE thread;
+} ReadAhead;
+
+// Checkpoint file contents: where to resume a transfer of the same file and frame size,
+// and a fingerprint of the file so a changed file is sent from the start
+typedef struct {
+	uint32_t magic;
+	int32_t file_size;
+	int32_t payload_size;
+	int32_t next_frame;     // First frame not yet acknowledged
+	int64_t mtime;          // Modification time of the file
+	uint32_t prefix_crc;    // CRC-32C of the file bytes before next_frame
+} Checkpoint;
+
+// Header of a shard given up after a collision, its late echo still counts
+typedef struct {
+	FrameEchoKey echo;
+	int index;
+	int wire_len;
+	int raw_wire_len;
+} AbandonedShard;
+
+// Shards of one other station's current FEC group, kept until the group can be rebuilt
+typedef struct {
+	bool in_use;
+	uint8_t src_mac[6];
+	uint32_t group;
+	int k;
+	int m;
+	bool done;              // All data frames received or rebuilt
+	int present_count;
+	bool present[FEC_MAX_SHARDS];
+	uint8_t* shards[FEC_MAX_SHARDS];
+	int lens[FEC_MAX_SHARDS];  // Bytes held in each shard buffer
+	int shard_len;          // Known once a parity frame arrives
+	int last_use;           // For replacing the least recently used entry
+} FecRxGroup;
+
+// Transmit state of a station, driven by the event loop
+typedef enum {
+	STATION_IDLE,           // No frame in flight, the next frame can be sent
+	STATION_WAIT_ECHO,      // Frame sent, waiting for the channel to echo it back
+	STATION_BACKOFF,        // Collision or timeout, waiting before the next attempt
+	STATION_CONNECTING,     // Connection lost: reconnect attempt in progress, or waiting to retry
+	STATION_DONE            // All frames acknowledged, or the transfer failed
+} StationState;
+
+typedef struct {
+	int index;
+	char file_name[260];
+	FILE* fp;
+	SOCKET socket;
+	StationState state;
+	double deadline;        // now_ms() at which the current wait (echo, backoff, reconnect) ends
+	char* send_buffer;      // Frame bytes the socket has not taken yet, sent as it drains
+	int send_capacity;
+	int send_len;
+	int send_offset;        // Bytes of send_buffer already sent
+	ReadAhead* readahead;
+	FrameRing ring;
+	ReadyFrame* frame;      // Frame in flight, held until its echo arrives
+	int attempt;            // Transmissions of the current frame so far
+	int frames_done;        // Frames acknowledged so far
+	int frame_size;         // Bytes sent per frame
+	int slot_time_ms;
+	int timeout_ms;
+	uint32_t rand_state;    // Backoff random generator state
+	char* recv_buffer;      // Shared by the stations of one worker
+	int recv_buffer_size;
+	char* decode_buffer;    // Decompression output, shared like recv_buffer
+	char* rx_partial;       // Start of a frame cut off at the end of the last read
+	int rx_partial_len;
+	int rx_partial_capacity;
+	bool verbose;           // Print per-frame events (single station only)
+	bool failed;
+	const char* chan_ip;    // Kept for reconnecting after the connection drops
+	int chan_port;
+	int connect_timeout_sec;
+	double reconnect_until; // now_ms() at which reconnecting is given up
+	char checkpoint_name[280];
+	FILE* checkpoint_fp;    // NULL when checkpointing is disabled
+	int checkpoint_interval;
+	int since_checkpoint;   // Frames acknowledged since the last checkpoint write
+	FILE* checkpoint_src;   // Second handle on the file, reads the acknowledged prefix
+	int64_t checkpoint_mtime;
+	uint32_t prefix_crc;    // CRC-32C of the first prefix_bytes bytes of the file
+	int64_t prefix_bytes;
+	// Forward error correction: a group is done once any fec_needed of its shards are echoed
+	int fec_group;          // Group being transmitted, -1 before the first
+	int fec_needed;         // Data frames in that group
+	int fec_untaken;        // Shards of the group not yet taken from the ring
+	uint64_t fec_delivered; // Echoed shards, bit per shard index
+	int fec_delivered_count;
+	int64_t fec_group_bytes;   // File bytes in the group's data frames
+	int fec_group_compressed;
+	bool abandon;           // After the backoff, move on to the next shard instead of retrying
+	AbandonedShard fec_abandoned[FEC_MAX_SHARDS];
+	int fec_abandoned_count;
+	FecRxGroup* fec_rx;     // Reassembly of other stations' groups (FEC_RX_SOURCES entries)
+	int fec_rx_clock;
+	// Statistics
+	double start_ms;
+	double end_ms;
+	int total_transmissions;
+	int max_transmissions;
+	int collisions;         // Noise received while waiting for an echo
+	int timeouts;           // Echo did not arrive before the deadline
+	int late_echoes;        // Echo arrived after its deadline, during backoff
+	int deferrals;          // Frames the channel turned away over its rate limit
+	int other_frames;       // Frames of other stations, stray noise and runts
+	int start_frame;        // First frame of this run (non-zero when resumed from a checkpoint)
+	int reconnects;         // Times the connection was re-established mid-transfer
+	int64_t payload_bytes;  // File bytes acknowledged
+	int64_t wire_bytes;     // Bytes on the wire for the acknowledged frames
+	int64_t raw_wire_bytes; // Bytes the same frames would have taken uncompressed
+	int compressed_frames;
+	int received_frames;    // Data frames of other stations delivered to us
+	int64_t received_bytes; // File bytes in those frames (after decompression)
+	int decode_errors;      // Compressed frames of other stations that failed to decompress
+	int corrupt_frames;     // Frames whose CRC-32C trailer did not match, treated as noise
+	int parity_transmissions;
+	int shards_abandoned;   // Shards given up after a collision, the group's other shards covered them
+	int shards_skipped;     // Shards never sent because their group was already complete
+	int groups_repaired;    // Groups completed with parity standing in for lost data frames
+	int fec_recovered;      // Data frames of other stations rebuilt from parity
+} Station;
+
+// Event loop thread servicing a group of stations
+typedef struct {
+	Station* stations;
+	int station_count;
+	char* recv_buffer;
+	int recv_buffer_size;
+	char* decode_buffer;
+	HANDLE thread;
+} Worker;
 
 // Function prototypes
 bool check_for_exit(void);
 SOCKET connect_to_channel(const char *chan_ip, int chan_port, int timeout_sec);
-void flush_socket(SOCKET s);
-int is_same_frame_header(FrameHeader* sent_header, FrameHeader* recv_header);
-
-// Function to check for Ctrl+Z input from user
+bool is_deferral_of(const char* deferral, const char* sent);
+bool frame_crc_ok(const char* frame, int available);
+bool ring_init(FrameRing* ring, FILE* fp, int depth, int total_frames, int file_size,
+	int frame_size, int payload_size, const uint8_t* src_mac, const uint8_t* dst_mac);
+void ring_free(FrameRing* ring);
+bool ring_enable_fec(FrameRing* ring, int k, int m);
+bool ring_has_work(FrameRing* ring);
+bool batch_add_file(const char* path, void* arg);
+bool batch_load(Batch* batch, const char* source);
+int batch_compare_names(const void* a, const void* b);
+void batch_free(Batch* batch);
+bool batch_open_next(FrameRing* ring);
+void batch_start_file(Station* st, int file_idx);
+void batch_check_file(Station* st);
+bool build_frame(FrameRing* ring, ReadyFrame* slot, int frame_idx, char* scratch);
+void ring_fec_stage(FrameRing* ring, ReadyFrame* slot, uint16_t type, int body_len);
+void build_parity_frame(FrameRing* ring, ReadyFrame* slot);
+void frame_add_crc(ReadyFrame* slot);
+DWORD WINAPI readahead_thread(LPVOID arg);
+bool readahead_start(ReadAhead* ra, FrameRing** rings, int ring_count);
+ReadyFrame* readahead_acquire(ReadAhead* ra, FrameRing* ring, bool wait);
+void readahead_release(ReadAhead* ra, FrameRing* ring);
+void readahead_stop(ReadAhead* ra);
+int station_rand(Station* st);
+bool station_send(Station* st, const char* data, int length);
+bool station_flush(Station* st);
+void receive_other_frame(Station* st, const char* frame, int length);
+void receive_payload(Station* st, uint16_t type, const char* body, int body_len);
+void receive_fec_shard(Station* st, const FrameHeader* header, const char* body, int body_len);
+FecRxGroup* fec_rx_lookup(Station* st, const uint8_t* src_mac, uint32_t group, int k, int m);
+void fec_rx_reset(FecRxGroup* g);
+void fec_rx_free(Station* st);
+int64_t file_mtime(const char* path);
+bool checkpoint_prefix_crc(Station* st, int64_t bytes);
+int checkpoint_open(Station* st, int file_size, int payload_size, int total_frames);
+void checkpoint_save(Station* st);
+void checkpoint_close(Station* st, bool completed);
+bool station_reconnect(Station* st);
+void station_connect_start(Station* st);
+void station_connect_failed(Station* st, int error);
+void station_connect_done(Station* st);
+void station_finish(Station* st, bool failed);
+void station_next_frame(Station* st, bool wait);
+void station_transmit(Station* st);
+void station_backoff(Station* st);
+void station_defer(Station* st, int retry_after_ms);
+bool station_fec_take(Station* st);
+void station_fec_delivered(Station* st, int index, int wire_len, int raw_wire_len);
+bool station_fec_late_echo(Station* st, const char* frame, int length);
+void station_fec_abandon(Station* st);
+void station_receive(Station* st);
+void station_receive_frame(Station* st, const char* frame, int length);
+void station_deadline(Station* st);
+void run_worker(Worker* w);
+DWORD WINAPI worker_thread(LPVOID arg);
+bool station_file_name(const char* pattern, int index, char* out, size_t out_size);
+void print_station_report(Station* st, int readahead_depth);
+void print_multi_station_report(Station* stations, int station_count, int readahead_depth, double duration_ms);
+void print_batch_report(Station* st, int readahead_depth, double duration_ms);
+void print_coding_report(const Station* st, int frames, double duration_ms);
+
+// Function to check for Ctrl+Z or Ctrl+C from the user
 bool check_for_exit(void) {
-	if (_kbhit()) {
-		int c = _getch();
-		// Check for Control+Z (ASCII 26) or Control+C (ASCII 3)
-		if (c == 26 || c == 3) {
-			//fprintf(stderr, "\nExit command detected (Ctrl+Z or Ctrl+C). Exiting...\n");
-			return true;
-		}
+	if (platform_shutdown_requested()) {
+		//fprintf(stderr, "\nExit command detected (Ctrl+Z or Ctrl+C). Exiting...\n");
+		return true;
 	}
 	return false;
 }
 
 // Function to connect to channel with retry mechanism
 SOCKET connect_to_channel(const char *chan_ip, int chan_port, int timeout_sec) {
-	WSADATA wsaData;
-	int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-	if (iResult != 0) {
-		fprintf(stderr, "Error at WSAStartup()\n");
-		return INVALID_SOCKET;
-	}
-
 	SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 	if (s == INVALID_SOCKET) {
-		fprintf(stderr, "Error at socket(): %ld\n", WSAGetLastError());
-		WSACleanup();
+		fprintf(stderr, "Error at socket(): %d\n", WSAGetLastError());
 		return INVALID_SOCKET;
 	}
 
@@ -71,15 +347,15 @@ SOCKET connect_to_channel(const char *chan_ip, int chan_port, int timeout_sec) {
 	//fprintf(stderr, "Attempting to connect to channel at %s:%d\n", chan_ip, chan_port);
 	//fprintf(stderr, "Press Ctrl+Z to cancel and exit...\n");
 
-	clock_t start_time = clock();
-	clock_t current_time;
+	double start_time = now_ms();
+	double current_time;
 	bool connected = false;
 
 	do {
 		// Check if user wants to exit
 		if (check_for_exit()) {
 			closesocket(s);
-			WSACleanup();
+			WSACleanup();    // Started by main()
 			exit(0); // Exit the program if user presses Ctrl+Z
 		}
 
@@ -98,346 +374,2280 @@ SOCKET connect_to_channel(const char *chan_ip, int chan_port, int timeout_sec) {
 		fprintf(stderr, "Channel not available yet, retrying in %d ms...\n", CONNECTION_RETRY_MS);
 		Sleep(CONNECTION_RETRY_MS);
 
-		current_time = clock();
-	} while (((current_time - start_time) / CLOCKS_PER_SEC) < timeout_sec);
+		current_time = now_ms();
+	} while ((current_time - start_time) / 1000.0 < timeout_sec);
 
 	if (!connected) {
 		fprintf(stderr, "Connection attempts timed out after %d seconds\n", timeout_sec);
 		closesocket(s);
-		WSACleanup();
 		return INVALID_SOCKET;
 	}
 
 	return s;
 }
 
-// Function to flush all pending data from a socket
-void flush_socket(SOCKET s) {
-	u_long avail = 0;
+// Function to check whether a DEFER frame turns away the given frame. The channel sends
+// back the frame's header with the type and length replaced.
+bool is_deferral_of(const char* deferral, const char* sent) {
+	return memcmp(deferral + FRAME_OFFSET_SRC_MAC, sent + FRAME_OFFSET_SRC_MAC, 6) == 0 &&
+		memcmp(deferral + FRAME_OFFSET_SEQ_NUM, sent + FRAME_OFFSET_SEQ_NUM, 4) == 0;
+}
 
-	// Check how many bytes are available to read
-	if (ioctlsocket(s, FIONREAD, &avail) != 0) {
-		//	fprintf(stderr, "Error checking socket buffer: %d\n", WSAGetLastError());
-		return;
+// Function to verify the CRC-32C trailer of a received frame. Frames sent without one
+// are accepted as they are; a frame whose flagged trailer is missing is not.
+bool frame_crc_ok(const char* frame, int available) {
+	if (!(frame_wire_type(frame) & FRAME_FLAG_CRC)) {
+		return true;
+	}
+	int covered = FRAME_HEADER_SIZE + frame_wire_length(frame);
+	if (covered + CRC32C_SIZE > available) {
+		return false;
 	}
 
-	if (avail > 0) {
-		//	fprintf(stderr, "Flushing %lu bytes from socket\n", avail);
+	return crc32c(0, frame, covered) == wire_get_u32(frame + covered);
+}
 
-		char temp_buf[1024];
-		while (avail > 0) {
-			int to_read = (avail > sizeof(temp_buf)) ? sizeof(temp_buf) : avail;
-			int read = recv(s, temp_buf, to_read, 0);
+// Function to allocate a station's ring of frame buffers
+bool ring_init(FrameRing* ring, FILE* fp, int depth, int total_frames, int file_size,
+	int frame_size, int payload_size, const uint8_t* src_mac, const uint8_t* dst_mac) {
+	memset(ring, 0, sizeof(*ring));
+	ring->fp = fp;
+	ring->depth = depth;
+	ring->total_frames = total_frames;
+	ring->file_size = file_size;
+	ring->frame_size = frame_size;
+	ring->payload_size = payload_size;
+	memcpy(ring->src_mac, src_mac, 6);
+	memcpy(ring->dst_mac, dst_mac, 6);
+	ring->fec_parity_next = -1;  // No parity frames unless FEC is enabled
+
+	// Frames below MIN_FRAME_SIZE still carry one payload byte after the header,
+	// and there is always room for the CRC trailer
+	ring->buffer_size = FRAME_HEADER_SIZE + payload_size + CRC32C_SIZE;
+	if (ring->buffer_size < frame_size) {
+		ring->buffer_size = frame_size;
+	}
 
-			if (read <= 0) {
-				if (read < 0) {
-					fprintf(stderr, "Error during socket flush: %d\n", WSAGetLastError());
-				}
-				break;
-			}
+	ring->slots = (ReadyFrame*)calloc(depth, sizeof(ReadyFrame));
+	if (!ring->slots) {
+		fprintf(stderr, "Memory allocation failed for read-ahead ring\n");
+		return false;
+	}
+	for (int i = 0; i < depth; i++) {
+		ring->slots[i].data = malloc(ring->buffer_size);
+		if (!ring->slots[i].data) {
+			fprintf(stderr, "Memory allocation failed for read-ahead frame buffer\n");
+			ring_free(ring);
+			return false;
+		}
+	}
+
+	return true;
+}
 
-			avail -= read;
+// Function to free a station's ring of frame buffers
+void ring_free(FrameRing* ring) {
+	if (ring->slots) {
+		for (int i = 0; i < ring->depth; i++) {
+			free(ring->slots[i].data);
 		}
+		free(ring->slots);
+		ring->slots = NULL;
+	}
+	free(ring->fec_shards);
+	ring->fec_shards = NULL;
+}
 
-		//	fprintf(stderr, "Socket flushed successfully\n");
+// Function to switch a ring to FEC groups of k data frames and m parity frames
+bool ring_enable_fec(FrameRing* ring, int k, int m) {
+	ring->fec_k = k;
+	ring->fec_m = m;
+	ring->fec_group = -1;
+	ring->fec_parity_next = -1;
+	ring->fec_shard_capacity = FEC_SHARD_PREFIX_SIZE + ring->payload_size;
+	ring->fec_shards = malloc((size_t)k * ring->fec_shard_capacity);
+	if (!ring->fec_shards) {
+		fprintf(stderr, "Memory allocation failed for FEC group buffer\n");
+		return false;
 	}
+	return true;
+}
+
+// Function to check whether the producer still has frames to build for a ring
+bool ring_has_work(FrameRing* ring) {
+	return ring->next_frame < ring->total_frames || ring->fec_parity_next >= 0 ||
+		(ring->batch && !ring->exhausted);
 }
 
-// Function to verify if received frame header matches sent frame header
-int is_same_frame_header(FrameHeader* sent_header, FrameHeader* recv_header) {
-	// Debug print to see what headers we're comparing
-	/*fprintf(stderr, "Comparing headers - Sent: type=%d, seq=%u, len=%d vs Received: type=%d, seq=%u, len=%d\n",
-		sent_header->type, sent_header->seq_num, sent_header->length,
-		recv_header->type, recv_header->seq_num, recv_header->length);
-		*/
-		// Check if all header fields match
-	if (recv_header->type != sent_header->type ||
-		recv_header->seq_num != sent_header->seq_num ||
-		recv_header->length != sent_header->length ||
-		memcmp(recv_header->src_mac, sent_header->src_mac, 6) != 0) {
-		return 0;  // Headers don't match
+// Function to add a file to a batch (callback of platform_list_files)
+bool batch_add_file(const char* path, void* arg) {
+	Batch* batch = (Batch*)arg;
+
+	if (strlen(path) >= sizeof(batch->files[0].name)) {
+		fprintf(stderr, "File name too long, skipped: %s\n", path);
+		return true;
+	}
+	if (batch->file_count == batch->capacity) {
+		int capacity = (batch->capacity > 0) ? batch->capacity * 2 : 64;
+		BatchFile* grown = (BatchFile*)realloc(batch->files, capacity * sizeof(BatchFile));
+		if (!grown) {
+			fprintf(stderr, "Memory allocation failed for batch file list\n");
+			return false;
+		}
+		batch->files = grown;
+		batch->capacity = capacity;
 	}
 
-	return 1;  // Headers match
+	BatchFile* file = &batch->files[batch->file_count++];
+	memset(file, 0, sizeof(*file));
+	strcpy(file->name, path);
+	return true;
 }
 
-int main(int argc, char *argv[]) {
-	if (argc != 8) {
-		fprintf(stderr, "Usage: %s <chan_ip> <chan_port> <file_name> <frame_size> <slot_time> <seed> <timeout>\n", argv[0]);
-		return 1;
+// Function to order a directory's files by name
+int batch_compare_names(const void* a, const void* b) {
+	return strcmp(((const BatchFile*)a)->name, ((const BatchFile*)b)->name);
+}
+
+// Function to build a batch from a directory (its files, by name) or a manifest (one
+// path per line; blank lines and lines starting with # are skipped)
+bool batch_load(Batch* batch, const char* source) {
+	memset(batch, 0, sizeof(*batch));
+	batch->source = source;
+	batch->current = -1;
+
+	if (platform_is_directory(source)) {
+		if (!platform_list_files(source, batch_add_file, batch)) {
+			fprintf(stderr, "Cannot read directory %s\n", source);
+			return false;
+		}
+		qsort(batch->files, batch->file_count, sizeof(BatchFile), batch_compare_names);
+	}
+	else {
+		FILE* manifest = fopen(source, "r");
+		if (!manifest) {
+			fprintf(stderr, "Cannot open manifest %s\n", source);
+			return false;
+		}
+		char line[1024];
+		while (fgets(line, sizeof(line), manifest)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			if (line[0] == '\0' || line[0] == '#') {
+				continue;
+			}
+			if (!batch_add_file(line, batch)) {
+				fclose(manifest);
+				return false;
+			}
+		}
+		fclose(manifest);
 	}
 
-	// Parse arguments 
-	const char *chan_ip = argv[1];
-	int chan_port = atoi(argv[2]);
-	const char *file_name = argv[3];
-	int frame_size = atoi(argv[4]);
-	int slot_time_ms = atoi(argv[5]);
-	int seed = atoi(argv[6]);
-	int timeout_sec = atoi(argv[7]);
+	if (batch->file_count == 0) {
+		fprintf(stderr, "No files to send in %s\n", source);
+		return false;
+	}
+	return true;
+}
 
-	// Store the original frame size requested by user
-	int original_frame_size = frame_size;
+// Function to free a batch's file list
+void batch_free(Batch* batch) {
+	free(batch->files);
+	batch->files = NULL;
+	batch->file_count = 0;
+}
 
-	// The actual frame size we'll use (ensure it's at least MIN_FRAME_SIZE)
-	int actual_frame_size = (frame_size < MIN_FRAME_SIZE) ? MIN_FRAME_SIZE : frame_size;
+// Function to move a batch ring on to its next file: the previous file is closed and
+// the next one opened and sized. A file that cannot be opened is marked failed and
+// left with no frames. Runs on the read-ahead thread. Returns false once no file is left.
+bool batch_open_next(FrameRing* ring) {
+	Batch* batch = ring->batch;
 
-	// Header size remains constant
-	const int header_size = sizeof(FrameHeader);
+	if (ring->fp) {
+		fclose(ring->fp);
+		ring->fp = NULL;
+	}
+	if (batch->next_open == batch->file_count) {
+		return false;
+	}
 
-	// Payload size based on user requested frame size, not the padded one
-	int payload_size = original_frame_size - header_size;
+	int idx = batch->next_open++;
+	BatchFile* file = &batch->files[idx];
+	ring->file_idx = idx;
+	ring->seq_base = (uint32_t)(idx & 0xFF) << BATCH_FILE_SHIFT;
+	ring->next_frame = 0;
+	ring->total_frames = 0;
+	ring->file_size = 0;
+	ring->fec_group = -1;
+	ring->fec_parity_next = -1;
+
+	ring->fp = fopen(file->name, "rb");
+	if (!ring->fp) {
+		fprintf(stderr, "Cannot open %s, skipped\n", file->name);
+		file->failed = true;
+		return true;
+	}
+	fseek(ring->fp, 0, SEEK_END);
+	long size = ftell(ring->fp);
+	rewind(ring->fp);
+
+	int64_t frames = ((int64_t)size + ring->payload_size - 1) / ring->payload_size;
+	if (size < 0 || frames >= BATCH_MAX_FRAMES) {
+		fprintf(stderr, "%s is too large for batch mode at this frame size, skipped\n", file->name);
+		fclose(ring->fp);
+		ring->fp = NULL;
+		file->failed = true;
+		return true;
+	}
+	ring->file_size = (int)size;
+	ring->total_frames = (int)frames;
+	file->file_size = ring->file_size;
+	file->total_frames = ring->total_frames;
+	file->opened = true;
+	return true;
+}
 
-	// If payload size would be negative (frame_size < header_size), set it to 0
-	if (payload_size < 0) {
-		payload_size = 0;
+// Function to close out the batch files before file_idx and start timing file_idx
+// (file_count once the batch is over). Files skipped on the way had no frames to send:
+// empty files count as sent, the rest as failed. Runs on the transmitter.
+void batch_start_file(Station* st, int file_idx) {
+	Batch* batch = st->ring.batch;
+	double now = now_ms();
+
+	for (int i = (batch->current < 0) ? 0 : batch->current; i < file_idx; i++) {
+		BatchFile* file = &batch->files[i];
+		if (file->done) {
+			continue;
+		}
+		if (file->opened && file->total_frames == 0) {
+			file->done = true;
+			file->start_ms = now;
+			file->end_ms = now;
+		}
+		else {
+			file->failed = true;
+			if (i == batch->current) {
+				file->transmissions = st->total_transmissions - batch->transmissions_base;
+				file->end_ms = now;
+			}
+		}
 	}
 
-	// If frame size is smaller than header size, warn but continue
-	if (frame_size <= header_size) {
-		fprintf(stderr, "Warning: Frame size %d is smaller than header size (%d bytes).\n",
-			frame_size, header_size);
-		fprintf(stderr, "Using minimum frame size of %d bytes with %d bytes payload per frame.\n",
-			MIN_FRAME_SIZE, payload_size);
+	batch->current = file_idx;
+	batch->frames_base = st->frames_done;
+	batch->transmissions_base = st->total_transmissions;
+	if (file_idx < batch->file_count) {
+		batch->files[file_idx].start_ms = now;
 	}
+}
 
-	srand(seed);
+// Function to check whether the file being sent is now completely acknowledged
+void batch_check_file(Station* st) {
+	Batch* batch = st->ring.batch;
+	BatchFile* file = &batch->files[batch->current];
 
-	// Connect to the channel with retry mechanism
-	SOCKET s = connect_to_channel(chan_ip, chan_port, timeout_sec);
-	if (s == INVALID_SOCKET) {
-		fprintf(stderr, "Error: Failed to connect to channel at %s:%d\n", chan_ip, chan_port);
-		return 1;
+	if (!file->done && !file->failed && st->frames_done - batch->frames_base == file->total_frames) {
+		file->done = true;
+		file->end_ms = now_ms();
+		file->transmissions = st->total_transmissions - batch->transmissions_base;
+	}
+}
+
+// Function to build one frame (header + payload read from the file) into a ring slot.
+// With compression on, the payload is read into scratch and compressed into the slot.
+bool build_frame(FrameRing* ring, ReadyFrame* slot, int frame_idx, char* scratch) {
+	const int header_size = FRAME_HEADER_SIZE;
+	// With FEC on, the FecHeader sits between the frame header and the payload
+	const int body_offset = header_size + (ring->fec_k > 0 ? FEC_HEADER_SIZE : 0);
+
+	// Calculate actual bytes to read for this frame
+	int bytes_to_read = ring->payload_size;
+	if (frame_idx == ring->total_frames - 1) {
+		int remaining_bytes = ring->file_size - (frame_idx * ring->payload_size);
+		if (remaining_bytes < ring->payload_size)
+			bytes_to_read = remaining_bytes;
 	}
 
-	FILE *fp = fopen(file_name, "rb"); //open the file 
-	if (!fp) {
-		//	perror("Error opening file");
-		closesocket(s);
-		WSACleanup();
-		return 1;
+	// Build header for this frame
+	FrameHeader header;
+	memcpy(header.src_mac, ring->src_mac, 6);
+	memcpy(header.dst_mac, ring->dst_mac, 6);
+	header.type = FRAME_TYPE_DATA;
+	header.seq_num = ring->seq_base + (uint32_t)frame_idx;
+
+	// Clear the rest of the frame (short payloads are zero-filled)
+	memset(slot->data + header_size, 0, ring->buffer_size - header_size);
+
+	slot->frame_idx = frame_idx;
+	slot->file_idx = ring->file_idx;
+	slot->payload_len = bytes_to_read;
+	slot->compressed = false;
+	slot->parity = false;
+
+	// Frames are produced in order, so the file is read sequentially without seeking
+	char* body = slot->data + body_offset;
+	char* payload = ring->compress ? scratch : body;
+	int body_len = bytes_to_read;  // Store the actual data length
+	if (bytes_to_read > 0) {
+		int bytes_read = (int)fread(payload, 1, bytes_to_read, ring->fp);
+		if (bytes_read != bytes_to_read) {
+			fprintf(stderr, "Error reading file at frame %d (read %d/%d bytes)\n",
+				frame_idx, bytes_read, bytes_to_read);
+			return false;
+		}
 	}
 
-	// Retrieve file size 
-	fseek(fp, 0, SEEK_END);
-	int total_file_size = ftell(fp);
-	rewind(fp);
+	if (ring->compress && bytes_to_read > 0 && bytes_to_read <= MAX_PAYLOAD_SIZE) {
+		// Only keep the compressed form if it is strictly smaller than the raw payload
+		int compressed_len = lz_compress((const uint8_t*)payload, bytes_to_read,
+			(uint8_t*)body + COMPRESSED_PREFIX_SIZE, bytes_to_read - COMPRESSED_PREFIX_SIZE - 1);
 
-	// Calculate the number of frames based on the original payload size
-	// If payload_size is 0, we'll send one byte per frame
-	int actual_payload_size = (payload_size > 0) ? payload_size : 1;
-	const int total_frames = (total_file_size + actual_payload_size - 1) / actual_payload_size;
+		if (compressed_len > 0) {
+			wire_put_u16(body, (uint16_t)bytes_to_read);
+			header.type |= FRAME_FLAG_COMPRESSED;
+			body_len = COMPRESSED_PREFIX_SIZE + compressed_len;
+			slot->compressed = true;
+		}
+		else {
+			memcpy(body, payload, bytes_to_read);
+		}
+	}
 
-	fprintf(stderr, "Starting transmission of %s (%d bytes in %d frames)\n",
-		file_name, total_file_size, total_frames);
-	fprintf(stderr, "User requested frame size: %d bytes\n", original_frame_size);
-	fprintf(stderr, "Actual frame size: %d bytes (header: %d bytes, effective payload: %d bytes)\n",
-		actual_frame_size, header_size, actual_payload_size);
+	header.length = (uint16_t)(body_offset - header_size + body_len);
+	// Sent without padding, so receivers find the next frame from the length field
+	slot->wire_len = header_size + header.length;
+	slot->raw_wire_len = slot->wire_len - body_len + bytes_to_read;
+	if (ring->fec_k > 0) {
+		ring_fec_stage(ring, slot, header.type, body_len);
+		header.type |= FRAME_FLAG_FEC;
+	}
+	frame_header_encode(&header, slot->data);
 
-	uint8_t my_mac[6] = { 0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x01 };
-	uint8_t channel_mac[6] = { 0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x00 };
+	return true;
+}
 
-	// Dynamically allocate memory for frame and receive buffer based on actual_frame_size
-	char *frame = malloc(actual_frame_size);
-	if (!frame) {
-		fprintf(stderr, "Memory allocation failed for frame buffer\n");
-		fclose(fp);
-		closesocket(s);
-		WSACleanup();
-		return 1;
+// Function to fill in a data frame's FecHeader and keep a copy of its body as a shard
+// of the group being loaded. The group's parity frames are built once it is complete.
+void ring_fec_stage(FrameRing* ring, ReadyFrame* slot, uint16_t type, int body_len) {
+	const int body_offset = FRAME_HEADER_SIZE + FEC_HEADER_SIZE;
+	int group = slot->frame_idx / ring->fec_k;
+	int index = slot->frame_idx % ring->fec_k;
+	int group_k = ring->total_frames - group * ring->fec_k;
+	if (group_k > ring->fec_k) {
+		group_k = ring->fec_k;
 	}
 
-	char *recv_buffer = malloc(actual_frame_size);
-	if (!recv_buffer) {
-		fprintf(stderr, "Memory allocation failed for receive buffer\n");
-		free(frame);
-		fclose(fp);
-		closesocket(s);
-		WSACleanup();
-		return 1;
+	FecHeader fec;
+	fec.group = ring->seq_base + (uint32_t)group;
+	fec.index = (uint8_t)index;
+	fec.k = (uint8_t)group_k;
+	fec.m = (uint8_t)ring->fec_m;
+	fec.shard_len = 0;
+	fec_header_encode(&fec, slot->data + FRAME_HEADER_SIZE);
+
+	slot->fec_group = (int)(ring->seq_base + (uint32_t)group);
+	slot->fec_index = index;
+	slot->fec_k = group_k;
+
+	// Shard = [body length][type][body], zero-padded to the capacity
+	uint8_t* shard = ring->fec_shards + (size_t)index * ring->fec_shard_capacity;
+	wire_put_u16(shard, (uint16_t)body_len);
+	wire_put_u16(shard + 2, type);
+	memcpy(shard + FEC_SHARD_PREFIX_SIZE, slot->data + body_offset, body_len);
+	memset(shard + FEC_SHARD_PREFIX_SIZE + body_len, 0,
+		ring->fec_shard_capacity - FEC_SHARD_PREFIX_SIZE - body_len);
+
+	int shard_len = FEC_SHARD_PREFIX_SIZE + body_len;
+	if (index == 0 || shard_len > ring->fec_shard_len) {
+		ring->fec_shard_len = shard_len;
 	}
+	int raw_shard_len = FEC_SHARD_PREFIX_SIZE + slot->payload_len;
+	if (index == 0 || raw_shard_len > ring->fec_raw_shard_len) {
+		ring->fec_raw_shard_len = raw_shard_len;
+	}
+	ring->fec_group = group;
+	if (index == group_k - 1) {
+		ring->fec_parity_next = 0;  // Group loaded, its parity frames come next
+	}
+}
 
-	int total_transmissions = 0;
-	int max_transmissions = 0;
-	int successful_frames = 0;
+// Function to build the next parity frame of the group that was just loaded
+void build_parity_frame(FrameRing* ring, ReadyFrame* slot) {
+	const int header_size = FRAME_HEADER_SIZE;
+	const uint8_t* data[FEC_MAX_SHARDS];
+	int group = ring->fec_group;
+	int parity_index = ring->fec_parity_next;
+	int group_k = ring->total_frames - group * ring->fec_k;
+	if (group_k > ring->fec_k) {
+		group_k = ring->fec_k;
+	}
 
-	clock_t start_time = clock();
+	for (int i = 0; i < group_k; i++) {
+		data[i] = ring->fec_shards + (size_t)i * ring->fec_shard_capacity;
+	}
 
-	for (int frame_idx = 0; frame_idx < total_frames; ++frame_idx) {
-		int current_attempt = 0;
-		int success = 0;
+	// Parity frames have their own sequence numbers, the type keeps them apart from data
+	FrameHeader header;
+	memcpy(header.src_mac, ring->src_mac, 6);
+	memcpy(header.dst_mac, ring->dst_mac, 6);
+	header.type = FRAME_TYPE_PARITY | FRAME_FLAG_FEC;
+	header.seq_num = ring->seq_base + (uint32_t)(group * ring->fec_m + parity_index);
+	header.length = (uint16_t)(FEC_HEADER_SIZE + ring->fec_shard_len);
+	frame_header_encode(&header, slot->data);
+
+	FecHeader fec;
+	fec.group = ring->seq_base + (uint32_t)group;
+	fec.index = (uint8_t)(group_k + parity_index);
+	fec.k = (uint8_t)group_k;
+	fec.m = (uint8_t)ring->fec_m;
+	fec.shard_len = (uint16_t)ring->fec_shard_len;
+	fec_header_encode(&fec, slot->data + header_size);
+
+	fec_encode_parity(group_k, parity_index, data,
+		(uint8_t*)slot->data + header_size + FEC_HEADER_SIZE, ring->fec_shard_len);
+
+	slot->frame_idx = group * ring->fec_k;
+	slot->file_idx = ring->file_idx;
+	slot->payload_len = 0;
+	slot->wire_len = header_size + header.length;
+	slot->raw_wire_len = header_size + FEC_HEADER_SIZE + ring->fec_raw_shard_len;
+	slot->compressed = false;
+	slot->parity = true;
+	slot->fec_group = (int)(ring->seq_base + (uint32_t)group);
+	slot->fec_index = group_k + parity_index;
+	slot->fec_k = group_k;
+
+	if (++ring->fec_parity_next == ring->fec_m) {
+		ring->fec_parity_next = -1;
+	}
+}
 
-		// Calculate actual bytes to read for this frame
-		int bytes_to_read = actual_payload_size;
-		if (frame_idx == total_frames - 1) {
-			int remaining_bytes = total_file_size - (frame_idx * actual_payload_size);
-			if (remaining_bytes < actual_payload_size)
-				bytes_to_read = remaining_bytes;
-		}
+// Function to mark a built frame as checksummed and append the CRC-32C of its header
+// and payload right after the payload.
+void frame_add_crc(ReadyFrame* slot) {
+	char* type = slot->data + FRAME_OFFSET_TYPE;
+	wire_put_u16(type, (uint16_t)(wire_get_u16(type) | FRAME_FLAG_CRC));
 
-		// Build header for this frame
-		FrameHeader header;
-		memcpy(header.src_mac, my_mac, 6);
-		memcpy(header.dst_mac, channel_mac, 6);
-		header.type = FRAME_TYPE_DATA;
-		header.seq_num = frame_idx;
-		header.length = bytes_to_read;  // Store the actual data length
+	int covered = FRAME_HEADER_SIZE + frame_wire_length(slot->data);
+	wire_put_u32(slot->data + covered, crc32c(0, slot->data, covered));
+	slot->raw_wire_len += covered + CRC32C_SIZE - slot->wire_len;
+	slot->wire_len = covered + CRC32C_SIZE;
+}
 
-		// Copy header into frame buffer
-		memcpy(frame, &header, header_size);
+// Producer thread: keeps every station's ring full until all files are loaded
+DWORD WINAPI readahead_thread(LPVOID arg) {
+	ReadAhead* ra = (ReadAhead*)arg;
+
+	EnterCriticalSection(&ra->lock);
+	while (!ra->stop) {
+		// Pick the next ring (round-robin) that has a free slot and frames left to load
+		FrameRing* ring = NULL;
+		bool pending = false;
+		for (int n = 0; n < ra->ring_count; n++) {
+			int idx = (ra->next_ring + n) % ra->ring_count;
+			FrameRing* candidate = ra->rings[idx];
+			if (candidate->failed || !ring_has_work(candidate)) {
+				continue;
+			}
+			pending = true;
+			if (candidate->count < candidate->depth) {
+				ring = candidate;
+				ra->next_ring = (idx + 1) % ra->ring_count;
+				break;
+			}
+		}
+		if (!pending) {
+			break;  // Every file has been fully loaded
+		}
+		if (!ring) {
+			// Wait for a transmitter to free a slot
+			SleepConditionVariableCS(&ra->not_full, &ra->lock, INFINITE);
+			continue;
+		}
 
-		// Clear the rest of the frame (for padding with zeros)
-		if (actual_frame_size > header_size) {
-			memset(frame + header_size, 0, actual_frame_size - header_size);
+		// The slot after the last ready frame is owned by the producer, so the
+		// disk read happens outside the lock
+		ReadyFrame* slot = &ring->slots[(ring->head + ring->count) % ring->depth];
+		int frame_idx = ring->next_frame;
+		bool parity = (ring->fec_parity_next >= 0);
+		bool next_file = (ring->batch && !parity && frame_idx >= ring->total_frames);
+		LeaveCriticalSection(&ra->lock);
+
+		if (next_file) {
+			// A batch file is loaded - open the next one while its last frames are sent
+			bool more = batch_open_next(ring);
+			EnterCriticalSection(&ra->lock);
+			if (!more) {
+				ring->exhausted = true;
+				WakeAllConditionVariable(&ra->not_empty);
+			}
+			continue;
 		}
 
-		// Read the file data for this frame
-		fseek(fp, frame_idx * actual_payload_size, SEEK_SET);
-		int bytes_read = 0;
+		bool ok = true;
+		if (parity) {
+			build_parity_frame(ring, slot);
+		}
+		else {
+			ok = build_frame(ring, slot, frame_idx, ra->scratch);
+		}
+		if (ok && ring->crc) {
+			frame_add_crc(slot);
+		}
+		if (ok) {
+			// The header is final, so the transmitter can match its echo without decoding
+			frame_echo_key(slot->data, &slot->echo);
+		}
 
-		// Only read from file if there's actual payload to read
-		if (bytes_to_read > 0) {
-			bytes_read = fread(frame + header_size, 1, bytes_to_read, fp);
-			if (bytes_read != bytes_to_read) {
-				fprintf(stderr, "Error reading file at frame %d (read %d/%d bytes)\n",
-					frame_idx, bytes_read, bytes_to_read);
-				break;
+		EnterCriticalSection(&ra->lock);
+		if (ok) {
+			if (!parity) {
+				ring->next_frame++;
 			}
+			ring->count++;
 		}
+		else if (ring->batch) {
+			// Only this file is lost, the batch goes on with the next one
+			ring->batch->files[ring->file_idx].failed = true;
+			ring->next_frame = ring->total_frames;
+			ring->fec_parity_next = -1;
+		}
+		else {
+			ring->failed = true;
+		}
+		WakeAllConditionVariable(&ra->not_empty);
+	}
+	LeaveCriticalSection(&ra->lock);
 
-		// Transmission loop for this frame - keep trying until success or MAX_ATTEMPTS
-		while (current_attempt < MAX_ATTEMPTS && !success) {
-			current_attempt++;
-			total_transmissions++;
+	return 0;
+}
 
-			// Clear receive buffer before sending
-			memset(recv_buffer, 0, actual_frame_size);
+// Function to start the producer thread over the given rings
+bool readahead_start(ReadAhead* ra, FrameRing** rings, int ring_count) {
+	memset(ra, 0, sizeof(*ra));
+	ra->rings = rings;
+	ra->ring_count = ring_count;
+
+	// Staging buffer for compressed rings, large enough for any ring's payload
+	int scratch_size = 1;
+	for (int i = 0; i < ring_count; i++) {
+		if (rings[i]->buffer_size > scratch_size) {
+			scratch_size = rings[i]->buffer_size;
+		}
+	}
+	ra->scratch = malloc(scratch_size);
+	if (!ra->scratch) {
+		fprintf(stderr, "Memory allocation failed for read-ahead scratch buffer\n");
+		return false;
+	}
 
-			// Flush socket to ensure clean state before sending
-			flush_socket(s);
+	InitializeCriticalSection(&ra->lock);
+	InitializeConditionVariable(&ra->not_empty);
+	InitializeConditionVariable(&ra->not_full);
 
-			// Send the frame - always send the entire actual_frame_size
-			int bytes_sent = send(s, frame, actual_frame_size, 0);
-			if (bytes_sent != actual_frame_size) {
-				fprintf(stderr, "Error sending frame %d (attempt %d): sent %d/%d bytes\n",
-					frame_idx, current_attempt, bytes_sent, actual_frame_size);
-				continue;
-			}
+	ra->thread = CreateThread(NULL, 0, readahead_thread, ra, 0, NULL);
+	if (!ra->thread) {
+		fprintf(stderr, "Failed to start read-ahead thread: %lu\n", (unsigned long)GetLastError());
+		DeleteCriticalSection(&ra->lock);
+		free(ra->scratch);
+		return false;
+	}
 
-			//	fprintf(stderr, "Sent frame %d (attempt %d) - %d bytes (payload: %d bytes)\n",
-			//		frame_idx, current_attempt, actual_frame_size, bytes_to_read);
+	return true;
+}
 
-				// Set up for listening with timeout
-			fd_set readfds;
-			FD_ZERO(&readfds);
-			FD_SET(s, &readfds);
+// Function to take a ring's next ready frame. If the ring is empty, either waits for
+// the producer or returns NULL so the caller can keep servicing its sockets.
+// Also returns NULL if the producer failed to read the frame (ring->failed is set) and
+// at the end of a batch (ring->exhausted is set).
+ReadyFrame* readahead_acquire(ReadAhead* ra, FrameRing* ring, bool wait) {
+	ReadyFrame* slot = NULL;
+
+	EnterCriticalSection(&ra->lock);
+	if (ring->count == 0 && !ring->failed && !ring->exhausted && !ring->stalled) {
+		// Transmitter is ready before the data is - record the stall
+		ring->stalled = true;
+		ring->stall_start = now_ms();
+		ring->stalls++;
+	}
+	while (wait && ring->count == 0 && !ring->failed && !ring->exhausted) {
+		SleepConditionVariableCS(&ra->not_empty, &ra->lock, INFINITE);
+	}
+	if (ring->count > 0) {
+		slot = &ring->slots[ring->head];
+		if (ring->stalled) {
+			ring->stalled = false;
+			ring->stall_ms += now_ms() - ring->stall_start;
+		}
+	}
+	LeaveCriticalSection(&ra->lock);
 
-			struct timeval timeout;
-			timeout.tv_sec = timeout_sec;
-			timeout.tv_usec = 0;
+	return slot;
+}
 
-			// Wait for response with timeout
-			int select_result = select(s + 1, &readfds, NULL, NULL, &timeout);
+// Function to hand the frame taken by readahead_acquire back to the producer
+void readahead_release(ReadAhead* ra, FrameRing* ring) {
+	EnterCriticalSection(&ra->lock);
+	ring->head = (ring->head + 1) % ring->depth;
+	ring->count--;
+	WakeConditionVariable(&ra->not_full);
+	LeaveCriticalSection(&ra->lock);
+}
 
-			if (select_result > 0) {
-				// Data available to read
-				int bytes_recv = recv(s, recv_buffer, actual_frame_size, 0);
-				//fprintf(stderr, "Received %d bytes back\n", bytes_recv);
+// Function to stop the producer thread
+void readahead_stop(ReadAhead* ra) {
+	if (ra->thread) {
+		EnterCriticalSection(&ra->lock);
+		ra->stop = true;
+		WakeConditionVariable(&ra->not_full);
+		LeaveCriticalSection(&ra->lock);
+
+		WaitForSingleObject(ra->thread, INFINITE);
+		CloseHandle(ra->thread);
+		ra->thread = NULL;
+		DeleteCriticalSection(&ra->lock);
+		free(ra->scratch);
+		ra->scratch = NULL;
+	}
+}
 
-				if (bytes_recv < header_size) {
-					//	fprintf(stderr, "Received truncated frame or noise signal\n");
-						// Flush socket and continue to backoff logic
-					flush_socket(s);
-				}
-				else {
-					FrameHeader* response = (FrameHeader*)recv_buffer;
+// Function to draw the next backoff random number for a station. Same generator as
+// the MSVC rand(), so station 0 reproduces the backoff sequence of srand(seed).
+int station_rand(Station* st) {
+	st->rand_state = st->rand_state * 214013u + 2531011u;
+	return (int)((st->rand_state >> 16) & 0x7FFF);
+}
 
-					if (response->type == FRAME_TYPE_NOISE) {
-						fprintf(stderr, "Collision detected (noise frame type=%d)\n", response->type);
-						// Flush socket to clear any buffered data after collision
-						flush_socket(s);
-					}
-					else if (is_same_frame_header((FrameHeader*)frame, response)) {
-						// SUCCESS - Header matches between sent and received frame
-						success = 1;
-						successful_frames++;
-						//fprintf(stderr, "Frame %d transmitted successfully\n", frame_idx);
-						break;  // Exit retry loop
-					}
-					else {
-						// Received a frame but the header doesn't match ours
-					//	fprintf(stderr, "Received mismatched frame, type=%d, seq=%u\n",
-					//		response->type, response->seq_num);
-						// Flush socket and continue to backoff logic
-						flush_socket(s);
-					}
-				}
+// Function to send a whole frame on a station's non-blocking socket. What the socket
+// does not take now is copied to the station's send buffer and sent by the event loop
+// as the socket drains (station_flush), so a slow connection never holds up the other
+// stations of the worker. Returns false if the connection failed.
+bool station_send(Station* st, const char* data, int length) {
+	int sent = 0;
+
+	// Nothing may overtake bytes still queued, a partial frame would desynchronize the stream
+	if (st->send_len == 0) {
+		sent = send(st->socket, data, length, 0);
+		if (sent == SOCKET_ERROR) {
+			if (WSAGetLastError() != WSAEWOULDBLOCK) {
+				return false;
 			}
-			else if (select_result == 0) {
-				// Timeout occurred, treat as collision
-				fprintf(stderr, "Timeout waiting for frame %d (attempt %d)\n", frame_idx, current_attempt);
-				// No need to flush after timeout as nothing was received
+			sent = 0;
+		}
+		if (sent == length) {
+			return true;
+		}
+	}
+
+	// Move the unsent bytes to the front, then append the rest of this frame
+	if (st->send_offset > 0) {
+		memmove(st->send_buffer, st->send_buffer + st->send_offset, st->send_len - st->send_offset);
+		st->send_len -= st->send_offset;
+		st->send_offset = 0;
+	}
+	int needed = st->send_len + length - sent;
+	if (needed > st->send_capacity) {
+		char* grown = (char*)realloc(st->send_buffer, needed);
+		if (!grown) {
+			fprintf(stderr, "Memory allocation failed for station %d's send buffer\n", st->index);
+			return false;
+		}
+		st->send_buffer = grown;
+		st->send_capacity = needed;
+	}
+	memcpy(st->send_buffer + st->send_len, data + sent, length - sent);
+	st->send_len = needed;
+	return true;
+}
+
+// Function to send what the socket can take of a station's send buffer. Returns false
+// if the connection failed.
+bool station_flush(Station* st) {
+	while (st->send_offset < st->send_len) {
+		int sent = send(st->socket, st->send_buffer + st->send_offset, st->send_len - st->send_offset, 0);
+		if (sent == SOCKET_ERROR) {
+			return WSAGetLastError() == WSAEWOULDBLOCK;
+		}
+		st->send_offset += sent;
+	}
+
+	st->send_len = 0;
+	st->send_offset = 0;
+	return true;
+}
+
+// Function to get a file's modification time, -1 if it cannot be read
+int64_t file_mtime(const char* path) {
+	struct stat info;
+	if (stat(path, &info) != 0) {
+		return -1;
+	}
+	return (int64_t)info.st_mtime;
+}
+
+// Function to bring the CRC-32C of the file's first `bytes` bytes up to date, reading
+// only what was acknowledged since the last call (from the start if `bytes` went back)
+bool checkpoint_prefix_crc(Station* st, int64_t bytes) {
+	char buffer[CHECKPOINT_READ_SIZE];
+
+	if (bytes < st->prefix_bytes) {
+		st->prefix_crc = 0;
+		st->prefix_bytes = 0;
+	}
+	if (fseek(st->checkpoint_src, (long)st->prefix_bytes, SEEK_SET) != 0) {
+		return false;
+	}
+	while (st->prefix_bytes < bytes) {
+		int64_t left = bytes - st->prefix_bytes;
+		size_t chunk = (left < CHECKPOINT_READ_SIZE) ? (size_t)left : CHECKPOINT_READ_SIZE;
+		if (fread(buffer, 1, chunk, st->checkpoint_src) != chunk) {
+			return false;
+		}
+		st->prefix_crc = crc32c(st->prefix_crc, buffer, chunk);
+		st->prefix_bytes += chunk;
+	}
+	return true;
+}
+
+// Function to load a station's checkpoint and open the checkpoint file for periodic
+// updates. The checkpoint is only used if it was written for this transfer and the
+// file still has the same modification time and acknowledged bytes.
+// Returns the frame to resume from.
+int checkpoint_open(Station* st, int file_size, int payload_size, int total_frames) {
+	int resume_frame = 0;
+
+	st->checkpoint_mtime = file_mtime(st->file_name);
+	st->checkpoint_src = fopen(st->file_name, "rb");
+	if (!st->checkpoint_src || st->checkpoint_mtime < 0) {
+		fprintf(stderr, "Warning: cannot fingerprint %s, transfer will not be resumable\n",
+			st->file_name);
+		return 0;
+	}
+
+	FILE* fp = fopen(st->checkpoint_name, "rb");
+	if (fp) {
+		Checkpoint ckpt;
+		if (fread(&ckpt, sizeof(ckpt), 1, fp) == 1 &&
+			ckpt.magic == CHECKPOINT_MAGIC &&
+			ckpt.file_size == file_size &&
+			ckpt.payload_size == payload_size &&
+			ckpt.next_frame > 0 && ckpt.next_frame < total_frames) {
+			if (ckpt.mtime == st->checkpoint_mtime &&
+				checkpoint_prefix_crc(st, (int64_t)ckpt.next_frame * payload_size) &&
+				st->prefix_crc == ckpt.prefix_crc) {
+				resume_frame = ckpt.next_frame;
 			}
 			else {
-				// Select error
-				fprintf(stderr, "Error in select(): %d\n", WSAGetLastError());
-				// Flush socket just to be sure
-				flush_socket(s);
+				fprintf(stderr, "Checkpoint %s does not match %s any more, sending it from the start\n",
+					st->checkpoint_name, st->file_name);
 			}
+		}
+		fclose(fp);
+	}
 
-			// Only continue with backoff if we haven't succeeded
-			if (success) {
-				break;  // Skip backoff logic if successful
-			}
+	st->checkpoint_fp = fopen(st->checkpoint_name, "wb");
+	if (!st->checkpoint_fp) {
+		fprintf(stderr, "Warning: cannot write checkpoint %s, transfer will not be resumable\n",
+			st->checkpoint_name);
+	}
 
-			// Check for max attempts
-			if (current_attempt >= MAX_ATTEMPTS) {
-				fprintf(stderr, "Max attempts reached for frame %d\n", frame_idx);
-				break;
-			}
+	return resume_frame;
+}
 
-			// Exponential backoff
-			int backoff_range = 1 << current_attempt;  // 2^k
-			int rand_slots = rand() % backoff_range;
-			int backoff_time = rand_slots * slot_time_ms;
+// Function to record the first unacknowledged frame in the station's checkpoint file
+void checkpoint_save(Station* st) {
+	if (!st->checkpoint_fp) {
+		return;
+	}
 
-			fprintf(stderr, "Backoff: waiting %d ms before retrying frame %d\n",
-				backoff_time, frame_idx);
-			Sleep(backoff_time);
-		}
+	int64_t acknowledged = (int64_t)st->frames_done * st->ring.payload_size;
+	if (acknowledged > st->ring.file_size) {
+		acknowledged = st->ring.file_size;
+	}
+	if (!checkpoint_prefix_crc(st, acknowledged)) {
+		return;     // Keep the last checkpoint, it is still valid
+	}
+
+	Checkpoint ckpt;
+	memset(&ckpt, 0, sizeof(ckpt));
+	ckpt.magic = CHECKPOINT_MAGIC;
+	ckpt.file_size = st->ring.file_size;
+	ckpt.payload_size = st->ring.payload_size;
+	ckpt.next_frame = st->frames_done;
+	ckpt.mtime = st->checkpoint_mtime;
+	ckpt.prefix_crc = st->prefix_crc;
+
+	// Overwrite in place - no fsync, losing the last interval only costs a resend
+	fseek(st->checkpoint_fp, 0, SEEK_SET);
+	fwrite(&ckpt, sizeof(ckpt), 1, st->checkpoint_fp);
+	fflush(st->checkpoint_fp);
+	st->since_checkpoint = 0;
+}
 
-		// Check if this frame failed after all attempts
-		if (!success) {
-			fprintf(stderr, "Frame %d failed after %d attempts\n", frame_idx, MAX_ATTEMPTS);
-			break;  // Exit the main frame loop
+// Function to close the checkpoint file, deleting it once the transfer is complete
+void checkpoint_close(Station* st, bool completed) {
+	if (st->checkpoint_src) {
+		if (!completed) {
+			checkpoint_save(st);
 		}
+		fclose(st->checkpoint_src);
+		st->checkpoint_src = NULL;
+	}
+	if (!st->checkpoint_fp) {
+		return;
+	}
+
+	fclose(st->checkpoint_fp);
+	st->checkpoint_fp = NULL;
 
-		// Update max transmissions stat
-		if (current_attempt > max_transmissions)
-			max_transmissions = current_attempt;
+	if (completed) {
+		remove(st->checkpoint_name);
 	}
+}
 
-	// Calculate statistics
-	clock_t end_time = clock();
-	int duration_ms = (int)((end_time - start_time) * 1000.0 / CLOCKS_PER_SEC);
-	double avg_transmissions = (double)total_transmissions / (successful_frames > 0 ? successful_frames : 1);
-	double avg_bandwidth_mbps = successful_frames > 0 ?
-		(8.0 * total_file_size) / (duration_ms / 1000.0) / 1000000.0 : 0;
+// Function to start re-establishing a dropped connection. The event loop completes it
+// (station_connect_done) and then resends the frame in flight. Returns false if the
+// station has run out of reconnects.
+bool station_reconnect(Station* st) {
+	// Persist progress first in case reconnecting fails and the program is rerun
+	checkpoint_save(st);
+
+	closesocket(st->socket);
+	st->socket = INVALID_SOCKET;
+	st->send_len = 0;        // Queued for the old connection, the frame is sent again
+	st->send_offset = 0;
+	st->rx_partial_len = 0;  // The new connection starts on a frame boundary
+
+	if (st->reconnects >= MAX_RECONNECTS) {
+		fprintf(stderr, "Station %d: giving up after %d reconnects\n", st->index, st->reconnects);
+		return false;
+	}
 
-	// Print results to stderr as required
-	fprintf(stderr, "\n");
-	fprintf(stderr, "Sent file %s\n", file_name);
-	fprintf(stderr, "Result: %s\n", (successful_frames == total_frames) ? "Success :)" : "Failure :(");
-	fprintf(stderr, "File size: %d Bytes (%d frames)\n", total_file_size, total_frames);
-	fprintf(stderr, "Total transfer time: %d milliseconds\n", duration_ms);
-	fprintf(stderr, "Transmissions/frame: average %.2f, maximum %d\n", avg_transmissions, max_transmissions);
-	fprintf(stderr, "Average bandwidth: %.3f Mbps\n", avg_bandwidth_mbps);
+	fprintf(stderr, "Station %d: connection to channel lost at frame %d, reconnecting...\n",
+		st->index, st->frames_done);
+	st->reconnect_until = now_ms() + st->connect_timeout_sec * 1000.0;
+	station_connect_start(st);
+	return true;
+}
 
-	// Clean up
-	free(frame);
-	free(recv_buffer);
-	fclose(fp);
-	closesocket(s);
-	WSACleanup();
-	return 0;
-}
\ No newline at end of file
+// Function to start a non-blocking connection attempt to the channel
+void station_connect_start(Station* st) {
+	struct sockaddr_in server_addr;
+	u_long mode = 1;
+
+	st->state = STATION_CONNECTING;
+	st->deadline = st->reconnect_until;
+	st->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (st->socket == INVALID_SOCKET) {
+		fprintf(stderr, "Station %d: error at socket(): %d\n", st->index, WSAGetLastError());
+		station_finish(st, true);
+		return;
+	}
+	ioctlsocket(st->socket, FIONBIO, &mode);
+
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_port = htons(st->chan_port);
+	server_addr.sin_addr.s_addr = inet_addr(st->chan_ip);
+	if (connect(st->socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0) {
+		station_connect_done(st);
+		return;
+	}
+
+	int error = WSAGetLastError();
+	if (error != WSAEWOULDBLOCK && error != WSAEINPROGRESS) {
+		station_connect_failed(st, error);
+	}
+}
+
+// Function to handle a failed connection attempt: while the channel is not available
+// yet, retry after CONNECTION_RETRY_MS until the connect timeout runs out
+void station_connect_failed(Station* st, int error) {
+	closesocket(st->socket);
+	st->socket = INVALID_SOCKET;
+
+	if (error != WSAECONNREFUSED && error != WSAENETUNREACH && error != WSAETIMEDOUT) {
+		fprintf(stderr, "Station %d: connection error: %d\n", st->index, error);
+		station_finish(st, true);
+		return;
+	}
+	if (now_ms() + CONNECTION_RETRY_MS >= st->reconnect_until) {
+		fprintf(stderr, "Station %d: reconnect attempts timed out after %d seconds\n",
+			st->index, st->connect_timeout_sec);
+		station_finish(st, true);
+		return;
+	}
+
+	// The retry starts when the deadline expires (station_deadline)
+	st->deadline = now_ms() + CONNECTION_RETRY_MS;
+}
+
+// Function to finish a connection attempt once the socket has reported its outcome
+void station_connect_done(Station* st) {
+	int error = 0;
+	socklen_t error_len = sizeof(error);
+
+	if (getsockopt(st->socket, SOL_SOCKET, SO_ERROR, (char*)&error, &error_len) == SOCKET_ERROR) {
+		error = WSAGetLastError();
+	}
+	if (error != 0) {
+		station_connect_failed(st, error);
+		return;
+	}
+
+	fprintf(stderr, "Station %d: reconnected to channel\n", st->index);
+	st->reconnects++;
+
+	// Every frame before frames_done was acknowledged, so the transfer resumes with the
+	// frame that was in flight - it is still held in the ring
+	if (st->frame) {
+		st->attempt = 0;
+		station_transmit(st);
+	}
+	else {
+		st->state = STATION_IDLE;
+	}
+}
+
+// Function to end a station's transfer
+void station_finish(Station* st, bool failed) {
+	st->failed = failed;
+	st->state = STATION_DONE;
+	st->end_ms = now_ms();
+}
+
+// Function to start transmitting the next frame once the ring has it ready
+void station_next_frame(Station* st, bool wait) {
+	for (;;) {
+		if (!st->ring.batch && st->frames_done == st->ring.total_frames) {
+			station_finish(st, false);
+			return;
+		}
+
+		// Take the next frame prepared by the read-ahead thread
+		st->frame = readahead_acquire(st->readahead, &st->ring, wait);
+		if (!st->frame) {
+			if (st->ring.failed) {
+				station_finish(st, true);  // Read error already reported by the producer
+			}
+			else if (st->ring.exhausted) {
+				// Batch over - the files' own results say which ones got through
+				batch_start_file(st, st->ring.batch->file_count);
+				station_finish(st, false);
+			}
+			return;  // Still loading - retried on the next loop iteration
+		}
+		if (st->ring.batch && st->frame->file_idx != st->ring.batch->current) {
+			batch_start_file(st, st->frame->file_idx);
+		}
+
+		if (st->ring.fec_k == 0 || station_fec_take(st)) {
+			break;
+		}
+
+		// The group is already complete, the rest of its shards are not needed
+		readahead_release(st->readahead, &st->ring);
+		st->frame = NULL;
+	}
+
+	st->attempt = 0;
+	station_transmit(st);
+}
+
+// Function to send the current frame and start waiting for its echo
+void station_transmit(Station* st) {
+	st->attempt++;
+	st->total_transmissions++;
+	st->parity_transmissions += st->frame->parity;
+
+	// Send the frame - header, payload and trailer, without padding. The echo timeout
+	// runs from here, including any time the frame waits in the send buffer.
+	if (!station_send(st, st->frame->data, st->frame->wire_len)) {
+		fprintf(stderr, "Error sending frame %d (attempt %d): %d\n",
+			st->frame->frame_idx, st->attempt, WSAGetLastError());
+		if (!station_reconnect(st)) {
+			station_finish(st, true);
+		}
+		return;
+	}
+
+	st->state = STATION_WAIT_ECHO;
+	st->deadline = now_ms() + st->timeout_ms;
+}
+
+// Function to schedule the next attempt after a collision or timeout
+void station_backoff(Station* st) {
+	int frame_idx = st->frame->frame_idx;
+
+	// With FEC, a lost shard is not retried while the shards still to come can cover it
+	st->abandon = (st->ring.fec_k > 0 &&
+		st->fec_delivered_count + st->fec_untaken >= st->fec_needed);
+
+	// Check for max attempts
+	if (!st->abandon && st->attempt >= MAX_ATTEMPTS) {
+		fprintf(stderr, "Max attempts reached for frame %d\n", frame_idx);
+		fprintf(stderr, "Frame %d failed after %d attempts\n", frame_idx, MAX_ATTEMPTS);
+		station_finish(st, true);
+		return;
+	}
+
+	// Exponential backoff
+	int backoff_range = 1 << st->attempt;  // 2^k
+	int rand_slots = station_rand(st) % backoff_range;
+	int backoff_time = rand_slots * st->slot_time_ms;
+
+	if (st->verbose) {
+		fprintf(stderr, "Backoff: waiting %d ms before %s frame %d\n",
+			backoff_time, st->abandon ? "moving on from" : "retrying", frame_idx);
+	}
+
+	// The socket keeps being serviced until the deadline, so a late echo
+	// still counts as success
+	st->state = STATION_BACKOFF;
+	st->deadline = now_ms() + backoff_time;
+}
+
+// Function to wait out a deferral. The channel turned the frame away before it took
+// part in a slot, so the attempt does not count: the same frame is sent again once
+// the channel's rate limit admits it.
+void station_defer(Station* st, int retry_after_ms) {
+	st->deferrals++;
+	st->attempt--;
+	st->total_transmissions--;
+	st->parity_transmissions -= st->frame->parity;
+
+	if (st->verbose) {
+		fprintf(stderr, "Deferred: waiting %d ms before retrying frame %d\n",
+			retry_after_ms, st->frame->frame_idx);
+	}
+
+	st->abandon = false;
+	st->state = STATION_BACKOFF;
+	st->deadline = now_ms() + retry_after_ms;
+}
+
+// Function to account for an FEC shard taken from the ring. Returns false if its group
+// is already complete, so the shard need not be sent.
+bool station_fec_take(Station* st) {
+	ReadyFrame* frame = st->frame;
+
+	if (frame->fec_group != st->fec_group) {
+		st->fec_group = frame->fec_group;
+		st->fec_needed = frame->fec_k;
+		st->fec_untaken = frame->fec_k + st->ring.fec_m;
+		st->fec_delivered = 0;
+		st->fec_delivered_count = 0;
+		st->fec_group_bytes = 0;
+		st->fec_group_compressed = 0;
+		st->fec_abandoned_count = 0;
+	}
+
+	st->fec_untaken--;
+	if (!frame->parity) {
+		st->fec_group_bytes += frame->payload_len;
+		st->fec_group_compressed += frame->compressed;
+	}
+	if (st->fec_delivered_count >= st->fec_needed) {
+		st->shards_skipped++;
+		return false;
+	}
+	return true;
+}
+
+// Function to record the echo of an FEC shard. The group's frames count as acknowledged
+// once any fec_needed of its shards got through.
+void station_fec_delivered(Station* st, int index, int wire_len, int raw_wire_len) {
+	uint64_t bit = 1ull << index;
+
+	if (st->fec_delivered & bit) {
+		return;
+	}
+	st->fec_delivered |= bit;
+	st->wire_bytes += wire_len;
+	st->raw_wire_bytes += raw_wire_len;
+
+	if (++st->fec_delivered_count == st->fec_needed) {
+		uint64_t data_mask = (1ull << st->fec_needed) - 1;
+		if ((st->fec_delivered & data_mask) != data_mask) {
+			st->groups_repaired++;
+		}
+		st->frames_done += st->fec_needed;
+		st->payload_bytes += st->fec_group_bytes;
+		st->compressed_frames += st->fec_group_compressed;
+		st->since_checkpoint += st->fec_needed;
+		st->fec_abandoned_count = 0;
+		if (st->ring.batch) {
+			batch_check_file(st);
+		}
+	}
+}
+
+// Function to look for late echoes of shards given up earlier in the current group
+bool station_fec_late_echo(Station* st, const char* frame, int length) {
+	for (int i = 0; i < st->fec_abandoned_count; i++) {
+		AbandonedShard* shard = &st->fec_abandoned[i];
+		if (frame_echo_matches(&shard->echo, frame) && frame_crc_ok(frame, length)) {
+			station_fec_delivered(st, shard->index, shard->wire_len, shard->raw_wire_len);
+			if (st->fec_abandoned_count > 0) {
+				st->fec_abandoned[i] = st->fec_abandoned[--st->fec_abandoned_count];
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+// Function to give up on the shard in flight once its backoff ends and move to the next one
+void station_fec_abandon(Station* st) {
+	AbandonedShard* shard = &st->fec_abandoned[st->fec_abandoned_count++];
+
+	shard->echo = st->frame->echo;
+	shard->index = st->frame->fec_index;
+	shard->wire_len = st->frame->wire_len;
+	shard->raw_wire_len = st->frame->raw_wire_len;
+	st->shards_abandoned++;
+
+	st->abandon = false;
+	st->frame = NULL;
+	st->state = STATION_IDLE;
+	readahead_release(st->readahead, &st->ring);
+}
+
+// Function to read from the channel and handle every complete frame in the data
+void station_receive(Station* st) {
+	// A frame cut off by the previous read is completed by this one
+	int carried = st->rx_partial_len;
+	if (carried > 0) {
+		memcpy(st->recv_buffer, st->rx_partial, carried);
+	}
+
+	int bytes_recv = recv(st->socket, st->recv_buffer + carried, st->recv_buffer_size - carried, 0);
+	if (bytes_recv == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+		return;
+	}
+	if (bytes_recv <= 0) {
+		if (!station_reconnect(st)) {
+			station_finish(st, true);
+		}
+		return;
+	}
+
+	// With many stations TCP often delivers several broadcast frames in one read, and
+	// splits large ones across reads, so walk the data frame by frame using each length
+	const char* frame = st->recv_buffer;
+	int available = carried + bytes_recv;
+	while (available >= FRAME_HEADER_SIZE && st->state != STATION_DONE) {
+		int frame_len = frame_wire_size(frame);
+		if (frame_len > available) {
+			break;
+		}
+		station_receive_frame(st, frame, frame_len);
+		frame += frame_len;
+		available -= frame_len;
+	}
+
+	// Keep the incomplete frame for the next read
+	if (available > st->rx_partial_capacity) {
+		char* grown = (char*)realloc(st->rx_partial, available);
+		if (!grown) {
+			fprintf(stderr, "Station %d: out of memory for a partial frame\n", st->index);
+			station_finish(st, true);
+			return;
+		}
+		st->rx_partial = grown;
+		st->rx_partial_capacity = available;
+	}
+	if (available > 0) {
+		memcpy(st->rx_partial, frame, available);
+	}
+	st->rx_partial_len = available;
+}
+
+// Function to classify one complete frame from the channel
+void station_receive_frame(Station* st, const char* frame, int length) {
+	const int header_size = FRAME_HEADER_SIZE;
+
+	uint16_t response_type = frame_wire_type(frame);
+	bool in_flight = (st->state == STATION_WAIT_ECHO || st->state == STATION_BACKOFF);
+
+	bool echo = in_flight && frame_echo_matches(&st->frame->echo, frame);
+	if (echo && !frame_crc_ok(frame, length)) {
+		// Our frame came back damaged - handled like noise, it has to be sent again
+		if (st->verbose) {
+			fprintf(stderr, "Corrupt echo of frame %d (CRC mismatch)\n", st->frame->frame_idx);
+		}
+		st->corrupt_frames++;
+		if (st->state == STATION_WAIT_ECHO) {
+			station_backoff(st);
+		}
+	}
+	else if (echo) {
+		// SUCCESS - Header matches between sent and received frame
+		if (st->state == STATION_BACKOFF) {
+			st->late_echoes++;
+		}
+		if (st->attempt > st->max_transmissions)
+			st->max_transmissions = st->attempt;
+		if (st->ring.fec_k > 0) {
+			station_fec_delivered(st, st->frame->fec_index, st->frame->wire_len, st->frame->raw_wire_len);
+		}
+		else {
+			st->frames_done++;
+			st->payload_bytes += st->frame->payload_len;
+			st->wire_bytes += st->frame->wire_len;
+			st->raw_wire_bytes += st->frame->raw_wire_len;
+			st->compressed_frames += st->frame->compressed;
+			st->since_checkpoint++;
+			if (st->ring.batch) {
+				batch_check_file(st);
+			}
+		}
+		st->frame = NULL;
+		st->abandon = false;
+		st->state = STATION_IDLE;
+
+		// Hand the slot back so the producer can load the next frame into it
+		readahead_release(st->readahead, &st->ring);
+
+		if (st->since_checkpoint >= st->checkpoint_interval) {
+			checkpoint_save(st);
+		}
+	}
+	else if (st->fec_abandoned_count > 0 && station_fec_late_echo(st, frame, length)) {
+		st->late_echoes++;
+		if (st->since_checkpoint >= st->checkpoint_interval) {
+			checkpoint_save(st);
+		}
+	}
+	else if (response_type == FRAME_TYPE_DEFER && st->state == STATION_WAIT_ECHO &&
+		length >= header_size + DEFER_BODY_SIZE && is_deferral_of(frame, st->frame->data)) {
+		// Only the deferral of the frame in flight - one left over from an earlier
+		// transmission must not push back the current frame
+		station_defer(st, wire_get_u16(frame + header_size));
+	}
+	else if (response_type == FRAME_TYPE_NOISE && st->state == STATION_WAIT_ECHO) {
+		if (st->verbose) {
+			fprintf(stderr, "Collision detected (noise frame type=%d)\n", response_type);
+		}
+		st->collisions++;
+		station_backoff(st);
+	}
+	else {
+		// Another station's frame, or noise for a slot we did not transmit in
+		st->other_frames++;
+		receive_other_frame(st, frame, length);
+	}
+}
+
+// Function to take delivery of another station's data frame, decompressing it if needed
+void receive_other_frame(Station* st, const char* frame, int length) {
+	const int header_size = FRAME_HEADER_SIZE;
+	FrameHeader header;
+	frame_header_decode(frame, &header);
+	int type = header.type & FRAME_TYPE_MASK;
+
+	if ((type != FRAME_TYPE_DATA && type != FRAME_TYPE_PARITY) || header_size + header.length > length) {
+		return;  // Noise, or a runt
+	}
+	if (!frame_crc_ok(frame, length)) {
+		st->corrupt_frames++;
+		return;
+	}
+
+	const char* body = frame + header_size;
+	int body_len = header.length;
+	if (header.type & FRAME_FLAG_FEC) {
+		if (body_len < FEC_HEADER_SIZE) {
+			st->decode_errors++;
+			return;
+		}
+		receive_fec_shard(st, &header, body, body_len);
+		if (type == FRAME_TYPE_PARITY) {
+			return;
+		}
+		body += FEC_HEADER_SIZE;
+		body_len -= FEC_HEADER_SIZE;
+	}
+	else if (type != FRAME_TYPE_DATA) {
+		return;
+	}
+
+	receive_payload(st, header.type, body, body_len);
+}
+
+// Function to count the file data carried in a data frame body
+void receive_payload(Station* st, uint16_t type, const char* body, int body_len) {
+	if (type & FRAME_FLAG_COMPRESSED) {
+		if (body_len < COMPRESSED_PREFIX_SIZE) {
+			st->decode_errors++;
+			return;
+		}
+		uint16_t original_len = wire_get_u16(body);
+
+		int decoded = lz_decompress((const uint8_t*)body + COMPRESSED_PREFIX_SIZE,
+			body_len - COMPRESSED_PREFIX_SIZE, (uint8_t*)st->decode_buffer, original_len);
+		if (decoded != original_len) {
+			st->decode_errors++;
+			return;
+		}
+		st->received_bytes += original_len;
+	}
+	else {
+		st->received_bytes += body_len;
+	}
+	st->received_frames++;
+}
+
+// Function to store a shard of another station's FEC group. Once k shards of the group
+// are in, data frames lost to collisions are rebuilt from the parity frames.
+void receive_fec_shard(Station* st, const FrameHeader* header, const char* body, int body_len) {
+	FecHeader fec;
+	fec_header_decode(body, &fec);
+	body += FEC_HEADER_SIZE;
+	body_len -= FEC_HEADER_SIZE;
+
+	bool parity = ((header->type & FRAME_TYPE_MASK) == FRAME_TYPE_PARITY);
+	if (fec.k == 0 || fec.k + fec.m > FEC_MAX_SHARDS || fec.index >= fec.k + fec.m ||
+		parity != (fec.index >= fec.k) || (parity && fec.shard_len != body_len)) {
+		st->decode_errors++;
+		return;
+	}
+
+	FecRxGroup* g = fec_rx_lookup(st, header->src_mac, fec.group, fec.k, fec.m);
+	if (!g || g->done || g->present[fec.index]) {
+		return;
+	}
+
+	// Data shards are stored as the sender built them: [body length][type][body]. The
+	// sender staged the type before adding the FEC and CRC flags, so both are cleared.
+	int shard_bytes = parity ? body_len : FEC_SHARD_PREFIX_SIZE + body_len;
+	uint8_t* shard = malloc(shard_bytes);
+	if (!shard) {
+		return;
+	}
+	if (parity) {
+		memcpy(shard, body, body_len);
+		g->shard_len = body_len;
+	}
+	else {
+		wire_put_u16(shard, (uint16_t)body_len);
+		wire_put_u16(shard + 2, (uint16_t)(header->type & ~(FRAME_FLAG_FEC | FRAME_FLAG_CRC)));
+		memcpy(shard + FEC_SHARD_PREFIX_SIZE, body, body_len);
+	}
+	g->shards[fec.index] = shard;
+	g->lens[fec.index] = shard_bytes;
+	g->present[fec.index] = true;
+
+	if (++g->present_count < g->k) {
+		return;
+	}
+
+	bool missing = false;
+	for (int i = 0; i < g->k; i++) {
+		missing |= !g->present[i];
+	}
+	if (missing && g->shard_len > 0) {
+		// Every shard takes part in decoding at the full shard length, zero-padded
+		bool ok = true;
+		for (int i = 0; i < g->k + g->m && ok; i++) {
+			if (i >= g->k && !g->present[i]) {
+				continue;
+			}
+			if (g->lens[i] < g->shard_len) {
+				uint8_t* grown = realloc(g->shards[i], g->shard_len);
+				if (!grown) {
+					ok = false;
+					break;
+				}
+				memset(grown + g->lens[i], 0, g->shard_len - g->lens[i]);
+				g->shards[i] = grown;
+				g->lens[i] = g->shard_len;
+			}
+		}
+
+		if (ok && fec_reconstruct(g->k, g->m, g->shards, g->present, g->shard_len) > 0) {
+			for (int i = 0; i < g->k; i++) {
+				if (g->present[i]) {
+					continue;
+				}
+				int shard_body_len = wire_get_u16(g->shards[i]);
+				if (shard_body_len > g->shard_len - FEC_SHARD_PREFIX_SIZE) {
+					st->decode_errors++;
+					continue;
+				}
+				receive_payload(st, wire_get_u16(g->shards[i] + 2),
+					(const char*)g->shards[i] + FEC_SHARD_PREFIX_SIZE, shard_body_len);
+				st->fec_recovered++;
+			}
+		}
+		else {
+			st->decode_errors++;
+		}
+	}
+
+	// Group finished - keep the entry so shards of it that arrive later are ignored
+	for (int i = 0; i < FEC_MAX_SHARDS; i++) {
+		free(g->shards[i]);
+		g->shards[i] = NULL;
+	}
+	g->done = true;
+}
+
+// Function to find the reassembly entry for a station's group, starting a new group (or
+// replacing the least recently used station) as needed. Returns NULL if out of memory.
+FecRxGroup* fec_rx_lookup(Station* st, const uint8_t* src_mac, uint32_t group, int k, int m) {
+	if (!st->fec_rx) {
+		st->fec_rx = (FecRxGroup*)calloc(FEC_RX_SOURCES, sizeof(FecRxGroup));
+		if (!st->fec_rx) {
+			return NULL;
+		}
+	}
+
+	FecRxGroup* g = NULL;
+	for (int i = 0; i < FEC_RX_SOURCES; i++) {
+		if (st->fec_rx[i].in_use && memcmp(st->fec_rx[i].src_mac, src_mac, 6) == 0) {
+			g = &st->fec_rx[i];
+			break;
+		}
+	}
+	if (!g) {
+		g = &st->fec_rx[0];
+		for (int i = 1; i < FEC_RX_SOURCES && g->in_use; i++) {
+			if (!st->fec_rx[i].in_use || st->fec_rx[i].last_use < g->last_use) {
+				g = &st->fec_rx[i];
+			}
+		}
+		fec_rx_reset(g);
+		memcpy(g->src_mac, src_mac, 6);
+	}
+	else if (g->group != group) {
+		// Groups are sent in order - a new group means the previous one is over
+		fec_rx_reset(g);
+		memcpy(g->src_mac, src_mac, 6);
+	}
+	else if (g->k != k || g->m != m) {
+		return NULL;
+	}
+
+	if (!g->in_use) {
+		g->in_use = true;
+		g->group = group;
+		g->k = k;
+		g->m = m;
+	}
+	g->last_use = ++st->fec_rx_clock;
+	return g;
+}
+
+// Function to drop the shards held by a reassembly entry
+void fec_rx_reset(FecRxGroup* g) {
+	for (int i = 0; i < FEC_MAX_SHARDS; i++) {
+		free(g->shards[i]);
+	}
+	memset(g, 0, sizeof(*g));
+}
+
+// Function to free a station's reassembly entries
+void fec_rx_free(Station* st) {
+	if (st->fec_rx) {
+		for (int i = 0; i < FEC_RX_SOURCES; i++) {
+			fec_rx_reset(&st->fec_rx[i]);
+		}
+		free(st->fec_rx);
+		st->fec_rx = NULL;
+	}
+}
+
+// Function to handle expiry of the current wait
+void station_deadline(Station* st) {
+	if (st->state == STATION_WAIT_ECHO) {
+		// Timeout occurred, treat as collision
+		if (st->verbose) {
+			fprintf(stderr, "Timeout waiting for frame %d (attempt %d)\n",
+				st->frame->frame_idx, st->attempt);
+		}
+		st->timeouts++;
+		station_backoff(st);
+	}
+	else if (st->state == STATION_BACKOFF) {
+		if (st->abandon) {
+			station_fec_abandon(st);
+		}
+		else {
+			station_transmit(st);
+		}
+	}
+	else if (st->state == STATION_CONNECTING) {
+		if (st->socket == INVALID_SOCKET) {
+			station_connect_start(st);    // Retry after a refused attempt
+		}
+		else {
+			fprintf(stderr, "Station %d: reconnect attempts timed out after %d seconds\n",
+				st->index, st->connect_timeout_sec);
+			station_finish(st, true);
+		}
+	}
+}
+
+// Function to run the event loop of a group of stations until all their transfers end
+void run_worker(Worker* w) {
+	// A lone station can block on its ring, a group must keep servicing the others
+	bool wait_for_data = (w->station_count == 1);
+
+	PlatformPollFd poll_fds[STATIONS_PER_WORKER];
+	int poll_index[STATIONS_PER_WORKER];    // Entry of each station in poll_fds, -1 if none
+
+	for (;;) {
+		int active = 0;
+		int poll_count = 0;
+		bool stalled = false;
+		double next_deadline = now_ms() + 1000.0;
+
+		// Ctrl+Z / Ctrl+C: stop every transfer, their checkpoints keep the progress
+		if (check_for_exit()) {
+			for (int i = 0; i < w->station_count; i++) {
+				if (w->stations[i].state != STATION_DONE) {
+					station_finish(&w->stations[i], true);
+				}
+			}
+			break;
+		}
+
+		for (int i = 0; i < w->station_count; i++) {
+			Station* st = &w->stations[i];
+
+			poll_index[i] = -1;
+			if (st->state == STATION_IDLE) {
+				station_next_frame(st, wait_for_data);
+				stalled |= (st->state == STATION_IDLE);
+			}
+			if (st->state == STATION_DONE) {
+				continue;
+			}
+
+			active++;
+			if (st->state != STATION_CONNECTING || st->socket != INVALID_SOCKET) {
+				// Writable: a connection attempt has an outcome, or queued bytes can go out
+				poll_index[i] = poll_count;
+				poll_fds[poll_count].fd = st->socket;
+				poll_fds[poll_count].events = (st->state == STATION_CONNECTING) ? POLLOUT :
+					(st->send_len > 0) ? (POLLIN | POLLOUT) : POLLIN;
+				poll_fds[poll_count].revents = 0;
+				poll_count++;
+			}
+			if (st->state != STATION_IDLE && st->deadline < next_deadline) {
+				next_deadline = st->deadline;
+			}
+		}
+
+		if (active == 0) {
+			break;
+		}
+
+		// Wait for an incoming frame or the earliest deadline, whichever comes first
+		double wait_ms = next_deadline - now_ms();
+		if (stalled && wait_ms > READAHEAD_POLL_MS) {
+			wait_ms = READAHEAD_POLL_MS;
+		}
+		if (wait_ms < 0) {
+			wait_ms = 0;
+		}
+
+		int poll_result = platform_poll(poll_fds, poll_count, wait_ms);
+		if (poll_result == SOCKET_ERROR && WSAGetLastError() != WSAEINTR) {
+			fprintf(stderr, "Error in poll(): %d\n", WSAGetLastError());
+			for (int i = 0; i < w->station_count; i++) {
+				if (w->stations[i].state != STATION_DONE) {
+					station_finish(&w->stations[i], true);
+				}
+			}
+			break;
+		}
+
+		double now = now_ms();
+		for (int i = 0; i < w->station_count; i++) {
+			Station* st = &w->stations[i];
+
+			if (st->state == STATION_DONE) {
+				continue;
+			}
+			short revents = (poll_result > 0 && poll_index[i] >= 0) ? poll_fds[poll_index[i]].revents : 0;
+			if (st->state == STATION_CONNECTING) {
+				if (revents != 0) {
+					station_connect_done(st);
+				}
+			}
+			else {
+				if ((revents & POLLOUT) && !station_flush(st)) {
+					fprintf(stderr, "Station %d: error sending: %d\n", st->index, WSAGetLastError());
+					if (!station_reconnect(st)) {
+						station_finish(st, true);
+					}
+					continue;
+				}
+				// A closed or failed connection is read too, recv() reports it
+				if (revents & (POLLIN | POLLHUP | POLLERR)) {
+					station_receive(st);
+				}
+			}
+			if ((st->state == STATION_WAIT_ECHO || st->state == STATION_BACKOFF ||
+				st->state == STATION_CONNECTING) && now >= st->deadline) {
+				station_deadline(st);
+			}
+		}
+	}
+}
+
+// Worker thread entry point
+DWORD WINAPI worker_thread(LPVOID arg) {
+	run_worker((Worker*)arg);
+	return 0;
+}
+
+// Function to build a station's file name. A single %d in the pattern is replaced by
+// the station index, so each station can send its own file.
+bool station_file_name(const char* pattern, int index, char* out, size_t out_size) {
+	const char* percent = strchr(pattern, '%');
+
+	if (!percent) {
+		return snprintf(out, out_size, "%s", pattern) < (int)out_size;
+	}
+	if (percent[1] != 'd' || strchr(percent + 2, '%')) {
+		fprintf(stderr, "Invalid file name pattern %s (only a single %%d is allowed)\n", pattern);
+		return false;
+	}
+	return snprintf(out, out_size, pattern, index) < (int)out_size;
+}
+
+// Function to print the report of a single-station transfer
+void print_station_report(Station* st, int readahead_depth) {
+	int total_frames = st->ring.total_frames;
+	int successful_frames = st->frames_done;
+	int duration_ms = (int)(st->end_ms - st->start_ms);
+	int frames_this_run = successful_frames - st->start_frame;
+	double avg_transmissions = (double)st->total_transmissions / (frames_this_run > 0 ? frames_this_run : 1);
+
+	// A resumed transfer only sent the frames after its checkpoint
+	int64_t bytes_this_run = (int64_t)st->ring.file_size - (int64_t)st->start_frame * st->ring.payload_size;
+	double avg_bandwidth_mbps = frames_this_run > 0 ?
+		(8.0 * bytes_this_run) / (duration_ms / 1000.0) / 1000000.0 : 0;
+
+	// Print results to stderr as required
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Sent file %s\n", st->file_name);
+	fprintf(stderr, "Result: %s\n", (successful_frames == total_frames) ? "Success :)" : "Failure :(");
+	fprintf(stderr, "File size: %d Bytes (%d frames)\n", st->ring.file_size, total_frames);
+	fprintf(stderr, "Total transfer time: %d milliseconds\n", duration_ms);
+	fprintf(stderr, "Transmissions/frame: average %.2f, maximum %d\n", avg_transmissions, st->max_transmissions);
+	fprintf(stderr, "Average bandwidth: %.3f Mbps\n", avg_bandwidth_mbps);
+	fprintf(stderr, "Read-ahead: depth %d, transmitter stalled %d times (%.1f ms waiting for data)\n",
+		readahead_depth, st->ring.stalls, st->ring.stall_ms);
+	fprintf(stderr, "Events: %d collisions, %d timeouts, %d late echoes, %d deferrals, %d other frames received\n",
+		st->collisions, st->timeouts, st->late_echoes, st->deferrals, st->other_frames);
+	print_coding_report(st, frames_this_run, duration_ms);
+	if (st->start_frame > 0 || st->reconnects > 0) {
+		fprintf(stderr, "Resumed transfer: %d frames skipped from checkpoint, %d reconnects, %d frames sent in this run\n",
+			st->start_frame, st->reconnects, frames_this_run);
+	}
+}
+
+// Function to print per-station and aggregate results of a multi-station run
+void print_multi_station_report(Station* stations, int station_count, int readahead_depth, double duration_ms) {
+	int succeeded = 0;
+	int64_t total_bytes = 0;
+	int total_frames = 0;
+	int total_transmissions = 0;
+	int max_transmissions = 0;
+	int collisions = 0;
+	int timeouts = 0;
+	int late_echoes = 0;
+	int deferrals = 0;
+	int stalls = 0;
+	double stall_ms = 0;
+	int resumed = 0;
+	int resumed_frames = 0;
+	int reconnects = 0;
+	Station coding;     // Compression, FEC and receive counters of all stations
+
+	memset(&coding, 0, sizeof(coding));
+	coding.ring.compress = stations[0].ring.compress;
+	coding.ring.fec_k = stations[0].ring.fec_k;
+	coding.ring.fec_m = stations[0].ring.fec_m;
+
+	fprintf(stderr, "\n");
+	for (int i = 0; i < station_count; i++) {
+		Station* st = &stations[i];
+		bool success = (st->frames_done == st->ring.total_frames);
+		int station_ms = (int)(st->end_ms - st->start_ms);
+		int frames_this_run = st->frames_done - st->start_frame;
+		double avg_transmissions = (double)st->total_transmissions / (frames_this_run > 0 ? frames_this_run : 1);
+		int64_t station_bytes = success ?
+			(int64_t)st->ring.file_size - (int64_t)st->start_frame * st->ring.payload_size :
+			(int64_t)frames_this_run * st->ring.payload_size;
+		double bandwidth_mbps = (frames_this_run > 0 && station_ms > 0) ?
+			(8.0 * station_bytes) / (station_ms / 1000.0) / 1000000.0 : 0;
+
+		fprintf(stderr, "Station %d (%02X:%02X:%02X:%02X:%02X:%02X) %s: %s, %d/%d frames in %d ms, "
+			"transmissions/frame %.2f (max %d), %d collisions, %d timeouts, %.3f Mbps%s\n",
+			st->index,
+			st->ring.src_mac[0], st->ring.src_mac[1], st->ring.src_mac[2],
+			st->ring.src_mac[3], st->ring.src_mac[4], st->ring.src_mac[5],
+			st->file_name, success ? "Success" : "Failure",
+			st->frames_done, st->ring.total_frames, station_ms,
+			avg_transmissions, st->max_transmissions, st->collisions, st->timeouts, bandwidth_mbps,
+			(st->start_frame > 0 || st->reconnects > 0) ? " (resumed)" : "");
+
+		succeeded += success;
+		if (frames_this_run > 0) {
+			total_bytes += station_bytes;
+		}
+		total_frames += frames_this_run;
+		if (st->start_frame > 0 || st->reconnects > 0) {
+			resumed++;
+			resumed_frames += frames_this_run;
+		}
+		reconnects += st->reconnects;
+		coding.payload_bytes += st->payload_bytes;
+		coding.wire_bytes += st->wire_bytes;
+		coding.raw_wire_bytes += st->raw_wire_bytes;
+		coding.compressed_frames += st->compressed_frames;
+		coding.parity_transmissions += st->parity_transmissions;
+		coding.shards_abandoned += st->shards_abandoned;
+		coding.shards_skipped += st->shards_skipped;
+		coding.groups_repaired += st->groups_repaired;
+		coding.fec_recovered += st->fec_recovered;
+		coding.received_frames += st->received_frames;
+		coding.received_bytes += st->received_bytes;
+		coding.decode_errors += st->decode_errors;
+		coding.corrupt_frames += st->corrupt_frames;
+		total_transmissions += st->total_transmissions;
+		if (st->max_transmissions > max_transmissions)
+			max_transmissions = st->max_transmissions;
+		collisions += st->collisions;
+		timeouts += st->timeouts;
+		late_echoes += st->late_echoes;
+		deferrals += st->deferrals;
+		stalls += st->ring.stalls;
+		stall_ms += st->ring.stall_ms;
+	}
+
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Stations: %d (%d succeeded)\n", station_count, succeeded);
+	fprintf(stderr, "Total: %lld Bytes (%d frames) in %d milliseconds\n",
+		(long long)total_bytes, total_frames, (int)duration_ms);
+	fprintf(stderr, "Transmissions/frame: average %.2f, maximum %d\n",
+		(double)total_transmissions / (total_frames > 0 ? total_frames : 1), max_transmissions);
+	fprintf(stderr, "Aggregate bandwidth: %.3f Mbps\n",
+		duration_ms > 0 ? (8.0 * total_bytes) / (duration_ms / 1000.0) / 1000000.0 : 0);
+	fprintf(stderr, "Events: %d collisions, %d timeouts, %d late echoes, %d deferrals\n",
+		collisions, timeouts, late_echoes, deferrals);
+	fprintf(stderr, "Read-ahead: depth %d, transmitters stalled %d times (%.1f ms waiting for data)\n",
+		readahead_depth, stalls, stall_ms);
+	print_coding_report(&coding, total_frames, duration_ms);
+	if (resumed > 0) {
+		fprintf(stderr, "Resumed transfers: %d stations, %d frames sent after resuming, %d reconnects\n",
+			resumed, resumed_frames, reconnects);
+	}
+}
+
+// Function to print per-file and aggregate results of a batch transfer
+void print_batch_report(Station* st, int readahead_depth, double duration_ms) {
+	Batch* batch = st->ring.batch;
+	int succeeded = 0;
+	int failed = 0;
+	int64_t total_bytes = 0;
+	int total_frames = 0;
+	double file_ms_total = 0;
+	double file_ms_max = 0;
+
+	fprintf(stderr, "\n");
+	for (int i = 0; i < batch->file_count; i++) {
+		BatchFile* file = &batch->files[i];
+		double file_ms = (file->end_ms > file->start_ms) ? file->end_ms - file->start_ms : 0;
+		double bandwidth_mbps = (file->done && file_ms > 0) ?
+			(8.0 * file->file_size) / (file_ms / 1000.0) / 1000000.0 : 0;
+
+		fprintf(stderr, "File %d %s: %s, %d Bytes (%d frames) in %.2f ms, transmissions/frame %.2f, %.3f Mbps\n",
+			i, file->name, file->done ? "Success" : (file->failed ? "Failure" : "Not sent"),
+			file->file_size, file->total_frames, file_ms,
+			(double)file->transmissions / (file->total_frames > 0 ? file->total_frames : 1), bandwidth_mbps);
+
+		if (file->done) {
+			succeeded++;
+			total_bytes += file->file_size;
+			total_frames += file->total_frames;
+			file_ms_total += file_ms;
+			if (file_ms > file_ms_max) {
+				file_ms_max = file_ms;
+			}
+		}
+		else if (file->failed) {
+			failed++;
+		}
+	}
+
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Sent batch %s\n", batch->source);
+	fprintf(stderr, "Result: %s\n", (succeeded == batch->file_count) ? "Success :)" : "Failure :(");
+	fprintf(stderr, "Files: %d (%d succeeded, %d failed, %d not sent)\n",
+		batch->file_count, succeeded, failed, batch->file_count - succeeded - failed);
+	fprintf(stderr, "Total: %lld Bytes (%d frames) in %d milliseconds\n",
+		(long long)total_bytes, total_frames, (int)duration_ms);
+	fprintf(stderr, "Files/sec: %.1f\n", duration_ms > 0 ? succeeded / (duration_ms / 1000.0) : 0);
+	fprintf(stderr, "Aggregate bandwidth: %.3f Mbps\n",
+		duration_ms > 0 ? (8.0 * total_bytes) / (duration_ms / 1000.0) / 1000000.0 : 0);
+	fprintf(stderr, "Per-file time: average %.2f ms, maximum %.2f ms\n",
+		succeeded > 0 ? file_ms_total / succeeded : 0, file_ms_max);
+	fprintf(stderr, "Transmissions/frame: average %.2f, maximum %d\n",
+		(double)st->total_transmissions / (st->frames_done > 0 ? st->frames_done : 1), st->max_transmissions);
+	fprintf(stderr, "Read-ahead: depth %d, transmitter stalled %d times (%.1f ms waiting for data)\n",
+		readahead_depth, st->ring.stalls, st->ring.stall_ms);
+	fprintf(stderr, "Events: %d collisions, %d timeouts, %d late echoes, %d deferrals, %d other frames received\n",
+		st->collisions, st->timeouts, st->late_echoes, st->deferrals, st->other_frames);
+	print_coding_report(st, st->frames_done, duration_ms);
+	if (st->reconnects > 0) {
+		fprintf(stderr, "Reconnects: %d\n", st->reconnects);
+	}
+}
+
+// Function to print the part of a report shared by every kind of transfer: compression
+// against the same frames sent uncompressed, FEC, other stations' frames and CRC
+// failures. For a multi-station run `st` holds the counters summed over the stations.
+void print_coding_report(const Station* st, int frames, double duration_ms) {
+	if (st->ring.compress) {
+		fprintf(stderr, "Compression: %d/%d frames compressed, %lld bytes on the wire vs %lld uncompressed (ratio %.2f)\n",
+			st->compressed_frames, frames, (long long)st->wire_bytes, (long long)st->raw_wire_bytes,
+			st->wire_bytes > 0 ? (double)st->raw_wire_bytes / st->wire_bytes : 0);
+		fprintf(stderr, "Goodput: %.3f Mbps of file data, %.3f Mbps on the wire\n",
+			duration_ms > 0 ? (8.0 * st->payload_bytes) / (duration_ms / 1000.0) / 1000000.0 : 0,
+			duration_ms > 0 ? (8.0 * st->wire_bytes) / (duration_ms / 1000.0) / 1000000.0 : 0);
+	}
+	if (st->ring.fec_k > 0) {
+		fprintf(stderr, "FEC: k=%d m=%d, %d parity transmissions, %d shards abandoned, %d shards skipped, "
+			"%d groups completed with parity\n",
+			st->ring.fec_k, st->ring.fec_m, st->parity_transmissions, st->shards_abandoned,
+			st->shards_skipped, st->groups_repaired);
+	}
+	if (st->received_frames > 0 || st->decode_errors > 0) {
+		fprintf(stderr, "Received from other stations: %d data frames (%d rebuilt from parity), %lld Bytes (%d failed to decode)\n",
+			st->received_frames, st->fec_recovered, (long long)st->received_bytes, st->decode_errors);
+	}
+	if (st->corrupt_frames > 0) {
+		fprintf(stderr, "Corrupt frames: %d failed the CRC-32C check and were treated as noise\n", st->corrupt_frames);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 8) {
+		fprintf(stderr, "Usage: %s <chan_ip> <chan_port> <file_name> <frame_size> <slot_time> <seed> <timeout> [options]\n", argv[0]);
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -readahead <depth>   Frames prepared ahead of transmission (default %d)\n", DEFAULT_READAHEAD_DEPTH);
+		fprintf(stderr, "  -stations <count>    Virtual stations driven by this process (default 1);\n");
+		fprintf(stderr, "                       a %%d in file_name is replaced by the station index\n");
+		fprintf(stderr, "  -checkpoint <frames> Make the transfer resumable: write <file_name>.ckpt every\n");
+		fprintf(stderr, "                       <frames> acknowledged frames (default off)\n");
+		fprintf(stderr, "  -compress            Compress each frame's payload when that makes it smaller\n");
+		fprintf(stderr, "  -no-crc              Send frames without the CRC-32C trailer\n");
+		fprintf(stderr, "  -fec <k> <m>         Send m parity frames after every k data frames; any k frames\n");
+		fprintf(stderr, "                       of a group deliver it (k + m <= %d)\n", FEC_MAX_SHARDS);
+		fprintf(stderr, "  -batch               file_name is a directory or a manifest (one path per line);\n");
+		fprintf(stderr, "                       its files are sent in order over one connection (one station,\n");
+		fprintf(stderr, "                       no checkpoints)\n");
+		return 1;
+	}
+
+	// Parse arguments 
+	const char *chan_ip = argv[1];
+	int chan_port = atoi(argv[2]);
+	const char *file_name = argv[3];
+	int frame_size = atoi(argv[4]);
+	int slot_time_ms = atoi(argv[5]);
+	int seed = atoi(argv[6]);
+	int timeout_sec = atoi(argv[7]);
+
+	// Parse optional arguments
+	int readahead_depth = DEFAULT_READAHEAD_DEPTH;
+	int station_count = 1;
+	int checkpoint_interval = 0;   // No checkpoints unless asked for
+	bool compress = false;
+	bool crc = true;
+	int fec_k = 0;
+	int fec_m = 0;
+	bool batch_mode = false;
+	for (int i = 8; i < argc; i++) {
+		if (strcmp(argv[i], "-readahead") == 0 && i + 1 < argc) {
+			readahead_depth = atoi(argv[++i]);
+			if (readahead_depth < 1) {
+				fprintf(stderr, "Read-ahead depth must be at least 1\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-stations") == 0 && i + 1 < argc) {
+			station_count = atoi(argv[++i]);
+			if (station_count < 1 || station_count > MAX_STATIONS) {
+				fprintf(stderr, "Station count must be between 1 and %d\n", MAX_STATIONS);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-compress") == 0) {
+			compress = true;
+		}
+		else if (strcmp(argv[i], "-no-crc") == 0) {
+			crc = false;
+		}
+		else if (strcmp(argv[i], "-fec") == 0 && i + 2 < argc) {
+			fec_k = atoi(argv[++i]);
+			fec_m = atoi(argv[++i]);
+			if (fec_k < 1 || fec_m < 1 || fec_k + fec_m > FEC_MAX_SHARDS) {
+				fprintf(stderr, "FEC needs k >= 1 and m >= 1 with k + m <= %d\n", FEC_MAX_SHARDS);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-batch") == 0) {
+			batch_mode = true;
+		}
+		else if (strcmp(argv[i], "-checkpoint") == 0 && i + 1 < argc) {
+			checkpoint_interval = atoi(argv[++i]);
+			if (checkpoint_interval < 1) {
+				fprintf(stderr, "Checkpoint interval must be at least 1 frame\n");
+				return 1;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// A batch is one station's connection; resuming would need a checkpoint per file
+	Batch batch;
+	if (batch_mode) {
+		if (station_count > 1) {
+			fprintf(stderr, "Batch mode sends over a single station\n");
+			return 1;
+		}
+		if (checkpoint_interval > 0) {
+			fprintf(stderr, "Batch mode cannot resume from checkpoints\n");
+			return 1;
+		}
+		if (!batch_load(&batch, file_name)) {
+			batch_free(&batch);
+			return 1;
+		}
+	}
+
+	// Store the original frame size requested by user
+	int original_frame_size = frame_size;
+
+	// The actual frame size we'll use (ensure it's at least MIN_FRAME_SIZE)
+	int actual_frame_size = (frame_size < MIN_FRAME_SIZE) ? MIN_FRAME_SIZE : frame_size;
+
+	// Header size remains constant
+	const int header_size = FRAME_HEADER_SIZE;
+
+	// The CRC trailer comes out of the payload, so checksummed frames keep their size
+	const int trailer_size = crc ? CRC32C_SIZE : 0;
+
+	// Payload size based on user requested frame size, not the padded one
+	int payload_size = original_frame_size - header_size - trailer_size;
+
+	// If payload size would be negative (frame_size < header_size), set it to 0
+	if (payload_size < 0) {
+		payload_size = 0;
+	}
+
+	// If frame size is smaller than header size, warn but continue
+	if (frame_size <= header_size) {
+		fprintf(stderr, "Warning: Frame size %d is smaller than header size (%d bytes).\n",
+			frame_size, header_size);
+		fprintf(stderr, "Using minimum frame size of %d bytes with %d bytes payload per frame.\n",
+			MIN_FRAME_SIZE, payload_size);
+	}
+
+	// With FEC, each frame also carries an FecHeader and parity frames a shard prefix,
+	// so data frames give up that much payload to keep parity frames within frame_size
+	if (fec_k > 0) {
+		payload_size -= FEC_HEADER_SIZE + FEC_SHARD_PREFIX_SIZE;
+		if (payload_size <= 0) {
+			fprintf(stderr, "Frame size %d is too small for FEC (minimum %d bytes)\n", frame_size,
+				header_size + trailer_size + FEC_HEADER_SIZE + FEC_SHARD_PREFIX_SIZE + 1);
+			return 1;
+		}
+	}
+
+	// Calculate the number of frames based on the original payload size
+	// If payload_size is 0, we'll send one byte per frame
+	int actual_payload_size = (payload_size > 0) ? payload_size : 1;
+
+	uint8_t channel_mac[6] = { 0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x00 };
+
+	Station* stations = (Station*)calloc(station_count, sizeof(Station));
+	FrameRing** rings = (FrameRing**)calloc(station_count, sizeof(FrameRing*));
+	if (!stations || !rings) {
+		fprintf(stderr, "Memory allocation failed for %d stations\n", station_count);
+		free(stations);
+		free(rings);
+		if (batch_mode) {
+			batch_free(&batch);
+		}
+		return 1;
+	}
+
+	// Ctrl+Z / Ctrl+C end the transfer through check_for_exit() instead of the process
+	platform_catch_shutdown();
+
+	// Winsock is started once for every station's connection, including reconnects
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		fprintf(stderr, "Error at WSAStartup()\n");
+		free(stations);
+		free(rings);
+		if (batch_mode) {
+			batch_free(&batch);
+		}
+		return 1;
+	}
+
+	// Set up every station: its own connection, MAC, file and backoff state
+	bool setup_ok = true;
+	for (int i = 0; i < station_count && setup_ok; i++) {
+		Station* st = &stations[i];
+		st->index = i;
+		st->socket = INVALID_SOCKET;
+		st->frame_size = actual_frame_size;
+		st->slot_time_ms = slot_time_ms;
+		st->timeout_ms = timeout_sec * 1000;
+		// Spread the seeds so stations of processes started with nearby seeds
+		// don't share backoff sequences; station 0 keeps the given seed
+		st->rand_state = (uint32_t)seed + (uint32_t)i * 0x9E3779B9u;
+		st->verbose = (station_count == 1);
+		st->chan_ip = chan_ip;
+		st->chan_port = chan_port;
+		st->connect_timeout_sec = timeout_sec;
+		st->checkpoint_interval = checkpoint_interval;
+		st->fec_group = -1;
+
+		if (!station_file_name(file_name, i, st->file_name, sizeof(st->file_name))) {
+			setup_ok = false;
+			break;
+		}
+
+		// Connect to the channel with retry mechanism
+		st->socket = connect_to_channel(chan_ip, chan_port, timeout_sec);
+		if (st->socket == INVALID_SOCKET) {
+			fprintf(stderr, "Error: Failed to connect to channel at %s:%d\n", chan_ip, chan_port);
+			setup_ok = false;
+			break;
+		}
+
+		// The event loop never blocks on a single station's socket
+		u_long mode = 1;
+		ioctlsocket(st->socket, FIONBIO, &mode);
+
+		// Station i gets MAC AA:BB:CC:xx:xx:xx with i + 1 in the low three bytes
+		uint8_t my_mac[6] = { 0xAA, 0xBB, 0xCC,
+			(uint8_t)((i + 1) >> 16), (uint8_t)((i + 1) >> 8), (uint8_t)(i + 1) };
+
+		if (batch_mode) {
+			// The read-ahead thread opens the files, each one as the one before is loaded
+			fprintf(stderr, "Starting batch transmission of %d files from %s\n", batch.file_count, file_name);
+			fprintf(stderr, "Actual frame size: %d bytes (header: %d bytes, effective payload: %d bytes)\n",
+				actual_frame_size, header_size, actual_payload_size);
+			if (!ring_init(&st->ring, NULL, readahead_depth, 0, 0,
+				actual_frame_size, actual_payload_size, my_mac, channel_mac)) {
+				setup_ok = false;
+				break;
+			}
+			st->ring.batch = &batch;
+			st->ring.compress = compress;
+			st->ring.crc = crc;
+			if (fec_k > 0 && !ring_enable_fec(&st->ring, fec_k, fec_m)) {
+				setup_ok = false;
+				break;
+			}
+			rings[i] = &st->ring;
+			continue;
+		}
+
+		st->fp = fopen(st->file_name, "rb"); //open the file 
+		if (!st->fp) {
+			//	perror("Error opening file");
+			setup_ok = false;
+			break;
+		}
+
+		// Retrieve file size 
+		fseek(st->fp, 0, SEEK_END);
+		int total_file_size = ftell(st->fp);
+		rewind(st->fp);
+
+		const int total_frames = (total_file_size + actual_payload_size - 1) / actual_payload_size;
+
+		if (st->verbose) {
+			fprintf(stderr, "Starting transmission of %s (%d bytes in %d frames)\n",
+				st->file_name, total_file_size, total_frames);
+			fprintf(stderr, "User requested frame size: %d bytes\n", original_frame_size);
+			fprintf(stderr, "Actual frame size: %d bytes (header: %d bytes, effective payload: %d bytes)\n",
+				actual_frame_size, header_size, actual_payload_size);
+		}
+
+		if (!ring_init(&st->ring, st->fp, readahead_depth, total_frames, total_file_size,
+			actual_frame_size, actual_payload_size, my_mac, channel_mac)) {
+			setup_ok = false;
+			break;
+		}
+		st->ring.compress = compress;
+		st->ring.crc = crc;
+		if (fec_k > 0 && !ring_enable_fec(&st->ring, fec_k, fec_m)) {
+			setup_ok = false;
+			break;
+		}
+
+		// Resume from the checkpoint of an earlier interrupted run, if there is one
+		if (checkpoint_interval > 0) {
+			if (station_count == 1) {
+				snprintf(st->checkpoint_name, sizeof(st->checkpoint_name), "%s.ckpt", st->file_name);
+			}
+			else {
+				snprintf(st->checkpoint_name, sizeof(st->checkpoint_name), "%s.%d.ckpt", st->file_name, i);
+			}
+			st->start_frame = checkpoint_open(st, total_file_size, actual_payload_size, total_frames);
+			if (fec_k > 0) {
+				st->start_frame -= st->start_frame % fec_k;  // Resume on a group boundary
+			}
+			if (st->start_frame > 0) {
+				fprintf(stderr, "Station %d: resuming %s from checkpoint at frame %d of %d\n",
+					i, st->file_name, st->start_frame, total_frames);
+				st->frames_done = st->start_frame;
+				st->ring.next_frame = st->start_frame;
+				fseek(st->fp, (long)st->start_frame * actual_payload_size, SEEK_SET);
+			}
+			checkpoint_save(st);
+		}
+		rings[i] = &st->ring;
+	}
+
+	if (station_count > 1 && setup_ok) {
+		fprintf(stderr, "Starting %d stations (frame size %d bytes, effective payload %d bytes)\n",
+			station_count, actual_frame_size, actual_payload_size);
+	}
+
+	// Start the read-ahead thread so disk reads stay off the transmit path
+	ReadAhead readahead;
+	if (setup_ok) {
+		setup_ok = readahead_start(&readahead, rings, station_count);
+	}
+
+	// One event loop thread per group of stations, the first group runs on this thread
+	size_t worker_count = ((size_t)station_count + STATIONS_PER_WORKER - 1) / STATIONS_PER_WORKER;
+	Worker* workers = setup_ok ? (Worker*)calloc(worker_count, sizeof(Worker)) : NULL;
+	if (setup_ok && !workers) {
+		fprintf(stderr, "Memory allocation failed for workers\n");
+		readahead_stop(&readahead);
+		setup_ok = false;
+	}
+
+	if (setup_ok) {
+		for (size_t w = 0; w < worker_count && setup_ok; w++) {
+			workers[w].stations = &stations[w * STATIONS_PER_WORKER];
+			workers[w].station_count = station_count - (int)w * STATIONS_PER_WORKER;
+			if (workers[w].station_count > STATIONS_PER_WORKER) {
+				workers[w].station_count = STATIONS_PER_WORKER;
+			}
+
+			// Dynamically allocate memory for the receive buffer shared by the group
+			// Room for the start of a frame carried over from the last read, plus a full read
+			workers[w].recv_buffer_size = FRAME_MAX_WIRE_SIZE + MIN_RECV_BUFFER_SIZE;
+			workers[w].recv_buffer = malloc(workers[w].recv_buffer_size);
+			workers[w].decode_buffer = malloc(MAX_PAYLOAD_SIZE);
+			if (!workers[w].recv_buffer || !workers[w].decode_buffer) {
+				fprintf(stderr, "Memory allocation failed for receive buffer\n");
+				setup_ok = false;
+				break;
+			}
+			for (int i = 0; i < workers[w].station_count; i++) {
+				Station* st = &workers[w].stations[i];
+				st->readahead = &readahead;
+				st->recv_buffer = workers[w].recv_buffer;
+				st->recv_buffer_size = workers[w].recv_buffer_size;
+				st->decode_buffer = workers[w].decode_buffer;
+				st->state = STATION_IDLE;
+			}
+		}
+		if (!setup_ok) {
+			readahead_stop(&readahead);
+		}
+	}
+
+	if (setup_ok) {
+		double start_ms = now_ms();
+		for (int i = 0; i < station_count; i++) {
+			stations[i].start_ms = start_ms;
+		}
+
+		for (size_t w = 1; w < worker_count; w++) {
+			workers[w].thread = CreateThread(NULL, 0, worker_thread, &workers[w], 0, NULL);
+			if (!workers[w].thread) {
+				fprintf(stderr, "Failed to start worker thread: %lu\n", (unsigned long)GetLastError());
+				for (int i = 0; i < workers[w].station_count; i++) {
+					station_finish(&workers[w].stations[i], true);
+				}
+			}
+		}
+		run_worker(&workers[0]);
+		for (size_t w = 1; w < worker_count; w++) {
+			if (workers[w].thread) {
+				WaitForSingleObject(workers[w].thread, INFINITE);
+				CloseHandle(workers[w].thread);
+			}
+		}
+
+		double duration_ms = now_ms() - start_ms;
+		readahead_stop(&readahead);
+		if (check_for_exit()) {
+			fprintf(stderr, "\nExit command detected (Ctrl+Z or Ctrl+C), transfer stopped\n");
+		}
+
+		if (batch_mode) {
+			print_batch_report(&stations[0], readahead_depth, duration_ms);
+		}
+		else if (station_count == 1) {
+			print_station_report(&stations[0], readahead_depth);
+		}
+		else {
+			print_multi_station_report(stations, station_count, readahead_depth, duration_ms);
+		}
+	}
+
+	// Clean up
+	if (workers) {
+		for (size_t w = 0; w < worker_count; w++) {
+			free(workers[w].recv_buffer);
+			free(workers[w].decode_buffer);
+		}
+		free(workers);
+	}
+	for (int i = 0; i < station_count; i++) {
+		Station* st = &stations[i];
+		checkpoint_close(st, st->state == STATION_DONE && !st->failed);
+		ring_free(&st->ring);
+		fec_rx_free(st);
+		if (st->fp) {
+			fclose(st->fp);
+		}
+		if (st->ring.batch && st->ring.fp) {
+			fclose(st->ring.fp);    // Batch file still open when the transfer ended
+		}
+		if (st->socket != INVALID_SOCKET) {
+			closesocket(st->socket);
+		}
+		free(st->send_buffer);
+		free(st->rx_partial);
+	}
+	free(rings);
+	free(stations);
+	if (batch_mode) {
+		batch_free(&batch);
+	}
+	WSACleanup();
+	return setup_ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// stats_shm.c - live channel statistics in a named shared-memory segment, published
+// under a sequence lock so readers can sample them at any rate
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "stats_shm.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+// Function to map the segment of the channel on `port`
+static bool stats_map(StatsShm* shm, int port, bool create) {
+	char name[64];
+
+	snprintf(name, sizeof(name), STATS_NAME_FORMAT, port);
+	if (create) {
+		// Backed by the paging file, gone once the channel and every reader close it
+		shm->mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			0, (DWORD)sizeof(StatsSegment), name);
+	}
+	else {
+		shm->mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name);
+	}
+	if (!shm->mapping) {
+		fprintf(stderr, "Cannot %s statistics segment %s: %lu\n",
+			create ? "create" : "open", name, GetLastError());
+		return false;
+	}
+
+	shm->segment = (StatsSegment*)MapViewOfFile(shm->mapping,
+		create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(StatsSegment));
+	if (!shm->segment) {
+		fprintf(stderr, "Cannot map statistics segment %s: %lu\n", name, GetLastError());
+		CloseHandle(shm->mapping);
+		shm->mapping = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+// Function to unmap the segment and close the mapping
+static void stats_unmap(StatsShm* shm) {
+	if (shm->segment) {
+		UnmapViewOfFile(shm->segment);
+		shm->segment = NULL;
+	}
+	if (shm->mapping) {
+		CloseHandle(shm->mapping);
+		shm->mapping = NULL;
+	}
+}
+
+#else
+
+// Function to map the segment of the channel on `port`
+static bool stats_map(StatsShm* shm, int port, bool create) {
+	char name[64];
+
+	shm->port = 0;
+	snprintf(name, sizeof(name), STATS_NAME_FORMAT, port);
+	// Unlike a Windows mapping the object outlives its users, so the channel removes
+	// the name when it closes and readers keep their mapping until they let it go
+	int fd = create ? shm_open(name, O_RDWR | O_CREAT, 0644) : shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot %s statistics segment %s: %d\n",
+			create ? "create" : "open", name, errno);
+		return false;
+	}
+	if (create && ftruncate(fd, sizeof(StatsSegment)) != 0) {
+		fprintf(stderr, "Cannot size statistics segment %s: %d\n", name, errno);
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(NULL, sizeof(StatsSegment), create ? PROT_READ | PROT_WRITE : PROT_READ,
+		MAP_SHARED, fd, 0);
+	close(fd);    // The mapping keeps the object alive
+	if (view == MAP_FAILED) {
+		fprintf(stderr, "Cannot map statistics segment %s: %d\n", name, errno);
+		return false;
+	}
+
+	shm->segment = (StatsSegment*)view;
+	if (create) {
+		shm->port = port;
+	}
+	return true;
+}
+
+// Function to unmap the segment, removing its name if the channel created it
+static void stats_unmap(StatsShm* shm) {
+	if (shm->segment) {
+		munmap(shm->segment, sizeof(StatsSegment));
+		shm->segment = NULL;
+	}
+	if (shm->port) {
+		char name[64];
+		snprintf(name, sizeof(name), STATS_NAME_FORMAT, shm->port);
+		shm_unlink(name);
+		shm->port = 0;
+	}
+}
+
+#endif
+
+bool stats_create(StatsShm* shm, int port, int slot_time_ms) {
+	if (!stats_map(shm, port, true)) {
+		return false;
+	}
+
+	// A reader may still hold the segment of an earlier channel on this port, so the
+	// reset goes through the sequence lock like any other update
+	StatsSegment* segment = shm->segment;
+	stats_write_begin(segment);
+	segment->version = STATS_VERSION;
+	segment->slot_time_ms = slot_time_ms;
+	segment->station_count = 0;
+	segment->slots = 0;
+	segment->busy_slots = 0;
+	segment->delivered_slots = 0;
+	segment->collision_slots = 0;
+	segment->corrupt_slots = 0;
+	segment->stations_dropped = 0;
+	segment->deferred_frames = 0;
+	memset(segment->stations, 0, sizeof(segment->stations));
+	segment->magic = STATS_MAGIC;
+	stats_write_end(segment);
+	InterlockedExchange(&segment->running, 1);
+
+	return true;
+}
+
+bool stats_attach(StatsShm* shm, int port) {
+	if (!stats_map(shm, port, false)) {
+		return false;
+	}
+	if (shm->segment->magic != STATS_MAGIC || shm->segment->version != STATS_VERSION) {
+		fprintf(stderr, "Statistics segment of port %d has an unknown layout\n", port);
+		stats_close(shm);
+		return false;
+	}
+	return true;
+}
+
+void stats_close(StatsShm* shm) {
+	stats_unmap(shm);
+}
+
+StatsStation* stats_add_station(StatsSegment* segment, uint32_t ip, uint16_t port) {
+	if (segment->station_count >= STATS_MAX_STATIONS) {
+		segment->stations_dropped++;
+		return NULL;
+	}
+
+	StatsStation* station = &segment->stations[segment->station_count++];
+	memset(station, 0, sizeof(*station));
+	station->ip = ip;
+	station->port = port;
+	station->connected = 1;
+	return station;
+}
+
+bool stats_snapshot(const StatsSegment* segment, StatsSegment* out, int max_retries) {
+	for (int attempt = 0; attempt <= max_retries; attempt++) {
+		LONG before = segment->sequence;
+		if (before & 1) {
+			YieldProcessor();    // Channel is in the middle of an update
+			continue;
+		}
+		MemoryBarrier();     // Read the sequence before the data
+
+		// Header first, then only the stations in use
+		memcpy(out, (const void*)segment, offsetof(StatsSegment, stations));
+		int count = out->station_count;
+		if (count < 0 || count > STATS_MAX_STATIONS) {
+			continue;
+		}
+		memcpy(out->stations, (const void*)segment->stations, count * sizeof(StatsStation));
+
+		MemoryBarrier();     // Read the data before checking the sequence again
+		if (segment->sequence == before) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,82 @@
+// stats_shm.h - live channel statistics in a named shared-memory segment, published
+// under a sequence lock so readers can sample them at any rate
+#ifndef STATS_SHM_H
+#define STATS_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "platform.h"
+
+#define STATS_MAGIC 0x53544131   // Set once the segment is initialised
+#define STATS_VERSION 2
+#define STATS_MAX_STATIONS 1024  // Stations beyond this are counted in the totals only
+#ifdef _WIN32
+#define STATS_NAME_FORMAT "Local\\pa1_channel_stats_%d"   // Filled in with the channel port
+#else
+#define STATS_NAME_FORMAT "/pa1_channel_stats_%d"          // POSIX shared memory object
+#endif
+
+typedef struct {
+	uint32_t ip;             // IPv4 address in network byte order
+	uint16_t port;           // Host byte order
+	uint16_t connected;
+	int64_t frames;          // Frames received from the station
+	int64_t bytes;
+	int64_t delivered;       // Frames broadcast to all stations
+	int64_t collisions;
+	int64_t corrupt;         // Frames that failed the CRC-32C check
+	int64_t deferred;        // Frames turned away over the rate limit (not in frames)
+} StatsStation;
+
+// Layout of the segment. Every field below `sequence` is written by the channel loop
+// only, between stats_write_begin() and stats_write_end().
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	int32_t slot_time_ms;
+	volatile LONG running;   // Cleared when the channel exits
+	volatile LONG sequence;  // Odd while an update is in progress
+	int32_t station_count;
+	int64_t slots;           // Channel loop iterations
+	int64_t busy_slots;      // Slots in which at least one frame arrived
+	int64_t delivered_slots;
+	int64_t collision_slots;
+	int64_t corrupt_slots;
+	int64_t stations_dropped;   // Connections that did not fit in stations[]
+	int64_t deferred_frames;    // Frames turned away over the rate limits, every station
+	StatsStation stations[STATS_MAX_STATIONS];
+} StatsSegment;
+
+typedef struct {
+#ifdef _WIN32
+	HANDLE mapping;
+#else
+	int port;                // Set while the channel owns the name, which it removes on close
+#endif
+	StatsSegment* segment;
+} StatsShm;
+
+// Creates (channel) or opens read-only (reader) the segment of the channel on `port`.
+bool stats_create(StatsShm* shm, int port, int slot_time_ms);
+bool stats_attach(StatsShm* shm, int port);
+void stats_close(StatsShm* shm);
+
+// Brackets an update. Only memory stores and one interlocked increment each - no
+// system call - so the channel can publish every slot.
+static __inline void stats_write_begin(StatsSegment* segment) {
+	InterlockedIncrement(&segment->sequence);
+}
+
+static __inline void stats_write_end(StatsSegment* segment) {
+	InterlockedIncrement(&segment->sequence);
+}
+
+// Returns the slot for a new station (zeroed, connected), or NULL if the table is full.
+// Must be called between stats_write_begin() and stats_write_end().
+StatsStation* stats_add_station(StatsSegment* segment, uint32_t ip, uint16_t port);
+
+// Copies a consistent snapshot of the segment into *out, retrying while the channel
+// is writing. Returns false if no consistent copy was taken within max_retries.
+bool stats_snapshot(const StatsSegment* segment, StatsSegment* out, int max_retries);
+
+#endif
@@ -0,0 +1,155 @@
+// statview.c - samples the live statistics of a running channel from its shared-memory
+// segment and prints per-station rates, the collision ratio and the slot utilization
+// Build: cl /O2 statview.c stats_shm.c platform.c
+// Usage: statview <chan_port> [interval_ms] [options]
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "stats_shm.h"
+
+#define SNAPSHOT_RETRIES 1000    // Attempts at a consistent copy before skipping a sample
+
+static double percent(int64_t part, int64_t whole) {
+	return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+// Prints the change between two snapshots taken `seconds` apart
+static void print_sample(const StatsSegment* now, const StatsSegment* prev, double seconds, double uptime, bool show_all) {
+	int64_t slots = now->slots - prev->slots;
+	int64_t busy = now->busy_slots - prev->busy_slots;
+	int64_t collisions = now->collision_slots - prev->collision_slots;
+
+	printf("[%8.1f s] %9.0f slots/s  utilization %5.1f%%  busy %5.1f%%  collision ratio %5.1f%%  corrupt %lld  deferred %lld\n",
+		uptime, slots / seconds,
+		percent(now->delivered_slots - prev->delivered_slots, slots),
+		percent(busy, slots),
+		percent(collisions, busy),
+		(long long)(now->corrupt_slots - prev->corrupt_slots),
+		(long long)(now->deferred_frames - prev->deferred_frames));
+
+	for (int i = 0; i < now->station_count; i++) {
+		const StatsStation* station = &now->stations[i];
+		StatsStation zero = { 0 };
+		const StatsStation* before = (i < prev->station_count) ? &prev->stations[i] : &zero;
+		int64_t frames = station->frames - before->frames;
+		int64_t deferred = station->deferred - before->deferred;
+
+		if (!show_all && frames == 0 && deferred == 0) {
+			continue;
+		}
+
+		const uint8_t* ip = (const uint8_t*)&station->ip;    // Network byte order
+		char endpoint[32];
+		snprintf(endpoint, sizeof(endpoint), "%u.%u.%u.%u:%u", ip[0], ip[1], ip[2], ip[3], station->port);
+
+		printf("  %-21s %9.1f frames/s %9.3f Mbps %9.1f delivered/s %9.1f collisions/s (%5.1f%%) %9.1f deferred/s%s\n",
+			endpoint,
+			frames / seconds,
+			(station->bytes - before->bytes) * 8.0 / (seconds * 1000000.0),
+			(station->delivered - before->delivered) / seconds,
+			(station->collisions - before->collisions) / seconds,
+			percent(station->collisions - before->collisions, frames),
+			deferred / seconds,
+			station->connected ? "" : "  disconnected");
+	}
+	if (now->stations_dropped > 0) {
+		printf("  (%lld stations not shown, table full)\n", (long long)now->stations_dropped);
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <chan_port> [interval_ms] [options]\n", argv[0]);
+		fprintf(stderr, "Options:\n");
+		fprintf(stderr, "  -count <n>           Stop after n samples\n");
+		fprintf(stderr, "  -all                 Also list stations that sent nothing in the interval\n");
+		return 1;
+	}
+
+	int chan_port = atoi(argv[1]);
+	int interval_ms = 1000;
+	int first_option = 2;
+	if (argc > 2 && argv[2][0] != '-') {
+		interval_ms = atoi(argv[2]);
+		first_option = 3;
+	}
+
+	// Parse optional arguments
+	int count = 0;
+	bool show_all = false;
+	for (int i = first_option; i < argc; i++) {
+		if (strcmp(argv[i], "-count") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-all") == 0) {
+			show_all = true;
+		}
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (interval_ms < 1) {
+		fprintf(stderr, "Interval must be at least 1 ms\n");
+		return 1;
+	}
+
+	StatsShm shm = { 0 };
+	if (!stats_attach(&shm, chan_port)) {
+		fprintf(stderr, "Is a channel running on port %d?\n", chan_port);
+		return 1;
+	}
+
+	StatsSegment* now = (StatsSegment*)malloc(sizeof(StatsSegment));
+	StatsSegment* prev = (StatsSegment*)malloc(sizeof(StatsSegment));
+	if (!now || !prev) {
+		fprintf(stderr, "Memory allocation failed\n");
+		return 1;
+	}
+
+	if (!stats_snapshot(shm.segment, prev, SNAPSHOT_RETRIES)) {
+		fprintf(stderr, "Could not read a consistent snapshot\n");
+		return 1;
+	}
+	printf("Channel on port %d, slot time %d ms, sampling every %d ms\n",
+		chan_port, prev->slot_time_ms, interval_ms);
+
+	double start = now_ms();
+	double last = start;
+	int samples = 0;
+	while (count == 0 || samples < count) {
+		Sleep(interval_ms);
+
+		if (!stats_snapshot(shm.segment, now, SNAPSHOT_RETRIES)) {
+			continue;    // Channel kept writing; try again next interval
+		}
+		double t = now_ms();
+
+		if (now->slots < prev->slots) {
+			printf("Channel restarted\n");    // New segment contents, start over
+		}
+		else {
+			print_sample(now, prev, (t - last) / 1000.0, (t - start) / 1000.0, show_all);
+			samples++;
+		}
+
+		StatsSegment* swap = prev;
+		prev = now;
+		now = swap;
+		last = t;
+
+		if (!shm.segment->running) {
+			printf("Channel stopped after %lld slots\n", (long long)prev->slots);
+			break;
+		}
+	}
+
+	free(now);
+	free(prev);
+	stats_close(&shm);
+	return 0;
+}
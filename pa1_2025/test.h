@@ -0,0 +1,36 @@
+// test.h - checks and the result line shared by the unit tests (test_*.c). Each test
+// is a program that exits with 0 when every check passed, so CTest can run it.
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+static int test_failures;
+static uint32_t test_rand_state = 1;
+
+// Records a failed check with its location and carries on with the next one
+#define TEST_CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+} while (0)
+
+// Same generator as the sender's station_rand, so inputs are the same on every run
+static __inline int test_rand(void) {
+	test_rand_state = test_rand_state * 214013u + 2531011u;
+	return (int)((test_rand_state >> 16) & 0x7FFF);
+}
+
+// Prints the result line and returns the exit code for main
+static __inline int test_result(const char* program) {
+	if (test_failures > 0) {
+		fprintf(stderr, "%s: %d checks failed\n", program, test_failures);
+		return 1;
+	}
+	printf("%s: all checks passed\n", program);
+	return 0;
+}
+
+#endif
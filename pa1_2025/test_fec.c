@@ -0,0 +1,77 @@
+// test_fec.c - FEC erasure code: every pattern of up to m lost shards is recovered, and
+// more than m losses are reported
+// Build: cl /O2 test_fec.c fec.c platform.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "fec.h"
+#include "test.h"
+
+#define SHARD_LEN 37             // Odd, so no code path can rely on word-sized shards
+
+// Group shapes checked, including the sender's default and a single parity shard
+static const int configs[][2] = { { 1, 1 }, { 2, 1 }, { 4, 1 }, { 4, 2 }, { 6, 3 }, { 8, 2 }, { 10, 4 } };
+
+static int popcount(unsigned mask) {
+	int count = 0;
+	for (; mask; mask &= mask - 1) {
+		count++;
+	}
+	return count;
+}
+
+// Tries every erasure pattern of a k+m group: bit i of the mask loses shard i
+static void test_group(int k, int m) {
+	int n = k + m;
+	uint8_t original[FEC_MAX_SHARDS][SHARD_LEN];
+	uint8_t received[FEC_MAX_SHARDS][SHARD_LEN];
+	const uint8_t* data[FEC_MAX_SHARDS];
+	uint8_t* shards[FEC_MAX_SHARDS];
+	bool present[FEC_MAX_SHARDS];
+
+	for (int i = 0; i < k; i++) {
+		for (int j = 0; j < SHARD_LEN; j++) {
+			original[i][j] = (uint8_t)test_rand();
+		}
+		data[i] = original[i];
+	}
+	for (int p = 0; p < m; p++) {
+		fec_encode_parity(k, p, data, original[k + p], SHARD_LEN);
+	}
+
+	for (unsigned lost = 0; lost < (1u << n); lost++) {
+		int lost_count = popcount(lost);
+		int lost_data = popcount(lost & ((1u << k) - 1));
+
+		memcpy(received, original, sizeof(received[0]) * n);
+		for (int i = 0; i < n; i++) {
+			present[i] = !(lost & (1u << i));
+			if (!present[i]) {
+				memset(received[i], 0xEE, SHARD_LEN);  // Stale bytes in the lost shard's buffer
+			}
+			shards[i] = received[i];
+		}
+
+		int rebuilt = fec_reconstruct(k, m, shards, present, SHARD_LEN);
+		if (lost_count > m) {
+			TEST_CHECK(rebuilt == -1);
+			continue;
+		}
+		TEST_CHECK(rebuilt == lost_data);
+		for (int i = 0; i < k; i++) {
+			if (memcmp(received[i], original[i], SHARD_LEN) != 0) {
+				fprintf(stderr, "k=%d m=%d lost=0x%x: data shard %d not recovered\n", k, m, lost, i);
+				test_failures++;
+			}
+		}
+	}
+}
+
+int main(void) {
+	for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+		test_group(configs[c][0], configs[c][1]);
+	}
+	return test_result("test_fec");
+}
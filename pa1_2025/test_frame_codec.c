@@ -0,0 +1,150 @@
+// test_frame_codec.c - frame and FEC header encoding: exact wire bytes, round trips,
+// wire size of a frame and echo matching
+// Build: cl /O2 test_frame_codec.c frame_codec.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "frame_codec.h"
+#include "test.h"
+
+#define ROUND_TRIPS 10000
+
+static const uint8_t src_mac[6] = { 0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x01 };
+static const uint8_t dst_mac[6] = { 0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x00 };
+
+static void make_header(FrameHeader* header, uint16_t type, uint32_t seq_num, uint16_t length) {
+	memcpy(header->src_mac, src_mac, 6);
+	memcpy(header->dst_mac, dst_mac, 6);
+	header->type = type;
+	header->seq_num = seq_num;
+	header->length = length;
+}
+
+// Fields land at their offsets in network byte order
+static void test_wire_layout(void) {
+	static const uint8_t expected[FRAME_HEADER_SIZE] = {
+		0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x01,
+		0xFF, 0xEE, 0xDD, 0x00, 0x00, 0x00,
+		0x06, 0x01,
+		0x12, 0x34, 0x56, 0x78,
+		0x05, 0xC8 };
+	FrameHeader header;
+	uint8_t wire[FRAME_HEADER_SIZE];
+
+	make_header(&header, FRAME_TYPE_PARITY | FRAME_FLAG_FEC | FRAME_FLAG_CRC, 0x12345678, 1480);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(memcmp(wire, expected, FRAME_HEADER_SIZE) == 0);
+	TEST_CHECK(frame_wire_type(wire) == (FRAME_TYPE_PARITY | FRAME_FLAG_FEC | FRAME_FLAG_CRC));
+	TEST_CHECK(frame_wire_length(wire) == 1480);
+
+	static const uint8_t fec_expected[FEC_HEADER_SIZE] = { 0x00, 0x01, 0x02, 0x03, 9, 8, 2, 0, 0x04, 0x00 };
+	FecHeader fec = { 0x00010203, 9, 8, 2, 1024 };
+	uint8_t fec_wire[FEC_HEADER_SIZE];
+	fec_header_encode(&fec, fec_wire);
+	TEST_CHECK(memcmp(fec_wire, fec_expected, FEC_HEADER_SIZE) == 0);
+}
+
+// Random headers decode to what was encoded, and re-encode to the same bytes
+static void test_round_trips(void) {
+	for (int i = 0; i < ROUND_TRIPS; i++) {
+		FrameHeader header, decoded;
+		uint8_t wire[FRAME_HEADER_SIZE], again[FRAME_HEADER_SIZE];
+
+		for (int b = 0; b < 6; b++) {
+			header.src_mac[b] = (uint8_t)test_rand();
+			header.dst_mac[b] = (uint8_t)test_rand();
+		}
+		header.type = (uint16_t)test_rand() ^ (uint16_t)(test_rand() << 1);
+		header.seq_num = ((uint32_t)test_rand() << 17) ^ ((uint32_t)test_rand() << 2) ^ (uint32_t)test_rand();
+		header.length = (uint16_t)test_rand() ^ (uint16_t)(test_rand() << 1);
+
+		frame_header_encode(&header, wire);
+		frame_header_decode(wire, &decoded);
+		TEST_CHECK(memcmp(decoded.src_mac, header.src_mac, 6) == 0);
+		TEST_CHECK(memcmp(decoded.dst_mac, header.dst_mac, 6) == 0);
+		TEST_CHECK(decoded.type == header.type);
+		TEST_CHECK(decoded.seq_num == header.seq_num);
+		TEST_CHECK(decoded.length == header.length);
+		frame_header_encode(&decoded, again);
+		TEST_CHECK(memcmp(again, wire, FRAME_HEADER_SIZE) == 0);
+
+		FecHeader fec, fec_decoded;
+		uint8_t fec_wire[FEC_HEADER_SIZE];
+		fec.group = header.seq_num;
+		fec.index = (uint8_t)test_rand();
+		fec.k = (uint8_t)test_rand();
+		fec.m = (uint8_t)test_rand();
+		fec.shard_len = header.length;
+		fec_header_encode(&fec, fec_wire);
+		fec_header_decode(fec_wire, &fec_decoded);
+		TEST_CHECK(fec_decoded.group == fec.group && fec_decoded.index == fec.index &&
+			fec_decoded.k == fec.k && fec_decoded.m == fec.m && fec_decoded.shard_len == fec.shard_len);
+	}
+}
+
+// The receive walk steps over header, payload and, when flagged, the CRC trailer
+static void test_wire_size(void) {
+	FrameHeader header;
+	uint8_t wire[FRAME_HEADER_SIZE];
+
+	make_header(&header, FRAME_TYPE_DATA, 1, 1000);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(frame_wire_size(wire) == FRAME_HEADER_SIZE + 1000);
+
+	make_header(&header, FRAME_TYPE_DATA | FRAME_FLAG_CRC | FRAME_FLAG_COMPRESSED, 1, 1000);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(frame_wire_size(wire) == FRAME_HEADER_SIZE + 1000 + CRC32C_SIZE);
+
+	make_header(&header, FRAME_TYPE_NOISE, 0xFFFFFFFF, 0);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(frame_wire_size(wire) == FRAME_HEADER_SIZE);
+
+	make_header(&header, FRAME_TYPE_DEFER, 7, DEFER_BODY_SIZE);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(frame_wire_size(wire) == FRAME_HEADER_SIZE + DEFER_BODY_SIZE);
+
+	make_header(&header, FRAME_TYPE_DATA | FRAME_FLAG_CRC, 1, 0xFFFF);
+	frame_header_encode(&header, wire);
+	TEST_CHECK(frame_wire_size(wire) == FRAME_MAX_WIRE_SIZE);
+}
+
+// An echo repeats source MAC, type, sequence number and length; the destination is ignored
+static void test_echo_matching(void) {
+	FrameHeader header;
+	FrameEchoKey key;
+	uint8_t sent[FRAME_HEADER_SIZE], received[FRAME_HEADER_SIZE];
+
+	make_header(&header, FRAME_TYPE_DATA | FRAME_FLAG_CRC, 1000, 1480);
+	frame_header_encode(&header, sent);
+	frame_echo_key(sent, &key);
+	TEST_CHECK(frame_echo_matches(&key, sent));
+
+	// Any single changed bit outside the destination MAC breaks the match
+	for (int byte = 0; byte < FRAME_HEADER_SIZE; byte++) {
+		bool compared = (byte < FRAME_OFFSET_DST_MAC || byte >= FRAME_OFFSET_TYPE);
+		for (int bit = 0; bit < 8; bit++) {
+			memcpy(received, sent, FRAME_HEADER_SIZE);
+			received[byte] ^= (uint8_t)(1 << bit);
+			TEST_CHECK(frame_echo_matches(&key, received) == !compared);
+		}
+	}
+
+	// A noise frame and a deferral of the same frame are not echoes
+	header.type = FRAME_TYPE_NOISE;
+	frame_header_encode(&header, received);
+	TEST_CHECK(!frame_echo_matches(&key, received));
+	header.type = FRAME_TYPE_DEFER;
+	header.length = DEFER_BODY_SIZE;
+	frame_header_encode(&header, received);
+	TEST_CHECK(!frame_echo_matches(&key, received));
+}
+
+int main(void) {
+	test_wire_layout();
+	test_round_trips();
+	test_wire_size();
+	test_echo_matching();
+	return test_result("test_frame_codec");
+}
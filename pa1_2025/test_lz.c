@@ -0,0 +1,140 @@
+// test_lz.c - LZ compressor: round trips of compressible, incompressible and short
+// inputs, and rejection of malformed blocks
+// Build: cl /O2 test_lz.c lz.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+#include "test.h"
+
+#define MAX_INPUT 65535          // Largest payload a frame can carry
+#define GUARD_SIZE 64            // Bytes after the output that decompression must not touch
+#define GUARD_BYTE 0xA5
+#define FUZZ_ROUNDS 2000
+
+static uint8_t input[MAX_INPUT];
+static uint8_t packed[LZ_COMPRESS_BOUND(MAX_INPUT)];
+static uint8_t output[MAX_INPUT + GUARD_SIZE];
+
+// Kinds of input the sender sees: text, runs of one byte, and already compressed data
+static void fill_text(uint8_t* p, int len) {
+	static const char words[] = "the channel echoes every frame back to all stations ";
+	for (int i = 0; i < len; i++) {
+		p[i] = (uint8_t)words[(i + i / 97) % (sizeof(words) - 1)];
+	}
+}
+
+static void fill_random(uint8_t* p, int len) {
+	for (int i = 0; i < len; i++) {
+		p[i] = (uint8_t)test_rand();
+	}
+}
+
+// Decompresses into `capacity` bytes followed by guard bytes. Returns the result of
+// lz_decompress after checking the guard is intact.
+static int decompress_guarded(const uint8_t* src, int src_len, int capacity) {
+	memset(output + capacity, GUARD_BYTE, GUARD_SIZE);
+	int result = lz_decompress(src, src_len, output, capacity);
+	for (int i = 0; i < GUARD_SIZE; i++) {
+		if (output[capacity + i] != GUARD_BYTE) {
+			TEST_CHECK(!"decompression wrote past its capacity");
+			break;
+		}
+	}
+	return result;
+}
+
+// Compresses `len` bytes of input with room for the worst case and checks they come back
+static void check_round_trip(int len) {
+	int packed_len = lz_compress(input, len, packed, LZ_COMPRESS_BOUND(len));
+	TEST_CHECK(packed_len > 0 && packed_len <= LZ_COMPRESS_BOUND(len));
+	if (packed_len <= 0) {
+		return;
+	}
+
+	TEST_CHECK(decompress_guarded(packed, packed_len, len) == len);
+	TEST_CHECK(memcmp(output, input, len) == 0);
+
+	// One byte short of the original size must be refused, not overflowed
+	if (len > 0) {
+		TEST_CHECK(decompress_guarded(packed, packed_len, len - 1) == -1);
+	}
+}
+
+static void test_round_trips(void) {
+	static const uint16_t sizes[] = { 0, 1, 4, 5, 12, 13, 16, 100, 255, 256, 1000, 1480, 4096, MAX_INPUT };
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		fill_text(input, sizes[i]);
+		check_round_trip(sizes[i]);
+		memset(input, 0, sizes[i]);
+		check_round_trip(sizes[i]);
+		fill_random(input, sizes[i]);
+		check_round_trip(sizes[i]);
+	}
+
+	// Every short length, where the match finder limits matter most
+	for (int len = 0; len <= 300; len++) {
+		fill_text(input, len);
+		check_round_trip(len);
+	}
+}
+
+// The sender passes a capacity below the input size to only keep real savings
+static void test_incompressible(void) {
+	fill_random(input, 1480);
+	TEST_CHECK(lz_compress(input, 1480, packed, 1480 - 3) == 0);
+
+	fill_text(input, 1480);
+	int packed_len = lz_compress(input, 1480, packed, 1480 - 3);
+	TEST_CHECK(packed_len > 0 && packed_len < 1480 - 3);
+	TEST_CHECK(lz_compress(input, 1480, packed, 1) == 0);
+	TEST_CHECK(lz_compress(input, 1480, packed, 0) == 0);
+}
+
+static void test_malformed(void) {
+	// Hand-built blocks: 4 literals "abcd", then a match
+	static const uint8_t offset_zero[] = { 0x40, 'a', 'b', 'c', 'd', 0x00, 0x00 };
+	static const uint8_t offset_too_far[] = { 0x40, 'a', 'b', 'c', 'd', 0x05, 0x00 };
+	static const uint8_t offset_cut[] = { 0x40, 'a', 'b', 'c', 'd', 0x04 };
+	static const uint8_t literals_cut[] = { 0x50, 'a', 'b', 'c', 'd' };
+	static const uint8_t literal_length_cut[] = { 0xF0, 0xFF };
+	static const uint8_t match_length_cut[] = { 0x4F, 'a', 'b', 'c', 'd', 0x04, 0x00, 0xFF };
+	static const uint8_t valid[] = { 0x40, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x10, 'e' };
+
+	TEST_CHECK(decompress_guarded(offset_zero, sizeof(offset_zero), 64) == -1);
+	TEST_CHECK(decompress_guarded(offset_too_far, sizeof(offset_too_far), 64) == -1);
+	TEST_CHECK(decompress_guarded(offset_cut, sizeof(offset_cut), 64) == -1);
+	TEST_CHECK(decompress_guarded(literals_cut, sizeof(literals_cut), 64) == -1);
+	TEST_CHECK(decompress_guarded(literal_length_cut, sizeof(literal_length_cut), 64) == -1);
+	TEST_CHECK(decompress_guarded(match_length_cut, sizeof(match_length_cut), 64) == -1);
+	TEST_CHECK(decompress_guarded(valid, sizeof(valid), 64) == 9);
+	TEST_CHECK(memcmp(output, "abcdabcde", 9) == 0);
+	TEST_CHECK(decompress_guarded(valid, sizeof(valid), 8) == -1);
+
+	// Every truncation of a real block either fails or yields less than the original
+	fill_text(input, 4096);
+	int packed_len = lz_compress(input, 4096, packed, LZ_COMPRESS_BOUND(4096));
+	TEST_CHECK(packed_len > 0);
+	for (int cut = 0; cut < packed_len; cut++) {
+		int result = decompress_guarded(packed, cut, 4096);
+		TEST_CHECK(result < 4096);
+	}
+
+	// Random bytes never write past the capacity
+	for (int round = 0; round < FUZZ_ROUNDS; round++) {
+		int len = 1 + test_rand() % 256;
+		int capacity = test_rand() % 1024;
+		fill_random(packed, len);
+		int result = decompress_guarded(packed, len, capacity);
+		TEST_CHECK(result >= -1 && result <= capacity);
+	}
+}
+
+int main(void) {
+	test_round_trips();
+	test_incompressible();
+	test_malformed();
+	return test_result("test_lz");
+}
@@ -0,0 +1,161 @@
+// trace.c - per-slot binary trace of the channel, recorded through a lock-free ring and
+// written to a pcap file by a background thread
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+#define TRACE_DRAIN_MS 10        // Writer thread wake-up interval while the ring is empty
+#define TRACE_FILE_BUFFER (1 << 20)
+
+#pragma pack(push, 1)
+typedef struct {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+} PcapFileHeader;
+
+typedef struct {
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint32_t incl_len;
+	uint32_t orig_len;
+} PcapRecordHeader;
+#pragma pack(pop)
+
+// Atomic load and store of a ring index. The Interlocked calls take a LONG, which only
+// carries the bits here - all arithmetic on the indices is unsigned and wraps.
+static uint32_t trace_load_index(volatile uint32_t* index) {
+	return (uint32_t)InterlockedCompareExchange((volatile LONG*)index, 0, 0);
+}
+
+static void trace_store_index(volatile uint32_t* index, uint32_t value) {
+	InterlockedExchange((volatile LONG*)index, (LONG)value);
+}
+
+// Function to write one record as a pcap packet
+static void trace_write_record(Trace* trace, const TraceRecord* record) {
+	PcapRecordHeader packet;
+	int64_t seconds = record->time_us / 1000000;
+
+	packet.ts_sec = (uint32_t)(trace->start_time_sec + seconds);
+	packet.ts_usec = (uint32_t)(record->time_us - seconds * 1000000);
+	packet.incl_len = sizeof(TraceRecord);
+	packet.orig_len = sizeof(TraceRecord);
+	fwrite(&packet, sizeof(packet), 1, trace->fp);
+	fwrite(record, sizeof(TraceRecord), 1, trace->fp);
+}
+
+// Writer thread: drains the ring to the file until trace_close()
+static DWORD WINAPI trace_writer_thread(LPVOID arg) {
+	Trace* trace = (Trace*)arg;
+
+	for (;;) {
+		// Read stop before head, so a stop request never skips the last commits
+		LONG stop = InterlockedCompareExchange(&trace->stop, 0, 0);
+		uint32_t head = trace_load_index(&trace->head);
+		uint32_t tail = trace->tail;
+
+		while (tail != head) {
+			trace_write_record(trace, &trace->records[tail & (trace->capacity - 1)]);
+			tail++;
+		}
+		// Hand the drained slots back to the channel loop
+		trace_store_index(&trace->tail, tail);
+
+		if (stop) {
+			break;
+		}
+		fflush(trace->fp);
+		Sleep(TRACE_DRAIN_MS);
+	}
+
+	return 0;
+}
+
+bool trace_open(Trace* trace, const char* path, uint32_t capacity) {
+	memset(trace, 0, sizeof(*trace));
+
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+		fprintf(stderr, "Trace ring capacity must be a power of two\n");
+		return false;
+	}
+
+	trace->records = (TraceRecord*)calloc(capacity, sizeof(TraceRecord));
+	if (!trace->records) {
+		fprintf(stderr, "Memory allocation failed for trace ring\n");
+		return false;
+	}
+	trace->capacity = capacity;
+
+	trace->fp = fopen(path, "wb");
+	if (!trace->fp) {
+		fprintf(stderr, "Cannot create trace file %s\n", path);
+		free(trace->records);
+		return false;
+	}
+	setvbuf(trace->fp, NULL, _IOFBF, TRACE_FILE_BUFFER);
+
+	PcapFileHeader header;
+	header.magic = 0xA1B2C3D4;    // Microsecond timestamps
+	header.version_major = 2;
+	header.version_minor = 4;
+	header.thiszone = 0;
+	header.sigfigs = 0;
+	header.snaplen = sizeof(TraceRecord);
+	header.network = TRACE_LINKTYPE;
+	fwrite(&header, sizeof(header), 1, trace->fp);
+
+	trace->start_ms = now_ms();
+	trace->start_time_sec = (int64_t)time(NULL);
+
+	trace->thread = CreateThread(NULL, 0, trace_writer_thread, trace, 0, NULL);
+	if (!trace->thread) {
+		fprintf(stderr, "Failed to start trace writer thread: %lu\n", (unsigned long)GetLastError());
+		fclose(trace->fp);
+		free(trace->records);
+		return false;
+	}
+
+	return true;
+}
+
+TraceRecord* trace_begin(Trace* trace) {
+	uint32_t head = trace->head;
+	uint32_t tail = trace_load_index(&trace->tail);
+
+	// Never wait for the writer on the channel's hot path - drop the record instead
+	if (head - tail >= trace->capacity) {
+		trace->dropped++;
+		return NULL;
+	}
+
+	TraceRecord* record = &trace->records[head & (trace->capacity - 1)];
+	record->time_us = (uint64_t)((now_ms() - trace->start_ms) * 1000.0);
+	return record;
+}
+
+void trace_commit(Trace* trace) {
+	// Full barrier: the record's contents are visible before the new head
+	trace_store_index(&trace->head, trace->head + 1);
+	trace->recorded++;
+}
+
+void trace_close(Trace* trace) {
+	if (!trace->thread) {
+		return;
+	}
+
+	InterlockedExchange(&trace->stop, 1);
+	WaitForSingleObject(trace->thread, INFINITE);
+	CloseHandle(trace->thread);
+	trace->thread = NULL;
+
+	fclose(trace->fp);
+	free(trace->records);
+	trace->records = NULL;
+}
@@ -0,0 +1,71 @@
+// trace.h - per-slot binary trace of the channel, recorded through a lock-free ring and
+// written to a pcap file by a background thread
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "platform.h"
+
+#define TRACE_MAX_FRAMES 8       // Frames kept per slot record (sender_count may be higher)
+#define TRACE_HEADER_BYTES 20    // Frame header bytes kept per frame
+#define TRACE_DEFAULT_CAPACITY 4096  // Records in the ring, a power of two
+#define TRACE_LINKTYPE 147       // pcap LINKTYPE_USER0: each packet is one TraceRecord
+
+#pragma pack(push, 1)
+typedef struct {
+	uint32_t sender_ip;      // IPv4 address in network byte order
+	uint16_t sender_port;    // Host byte order
+	uint16_t reserved;
+	int32_t bytes;           // Bytes of the frame
+	double arrival_ms;       // When the channel took the frame, ms since the trace was opened
+	uint32_t crc_trailer;    // CRC-32C trailer as received, 0 if the frame has none
+	uint32_t crc_computed;   // CRC-32C the channel computed over header and payload
+	uint8_t header[TRACE_HEADER_BYTES];  // Frame header as received
+} TraceFrame;
+
+// One slot with traffic. The pcap packet data is this struct, little-endian.
+typedef struct {
+	uint64_t time_us;        // Microseconds since the trace was opened
+	uint32_t slot;           // Channel loop iteration, gaps are idle slots
+	uint8_t outcome;         // SLOT_DELIVERED / SLOT_COLLISION / SLOT_CORRUPT (channel_core.h)
+	uint8_t sender_count;    // Frames received in the slot
+	uint8_t frame_count;     // Entries of frames[] filled in
+	uint8_t reserved;
+	double decided_ms;       // Channel time of the decision, same base as arrival_ms
+	double link_rate_bps;    // Link model the slot was decided with, 0 when not in use
+	double propagation_ms;
+	TraceFrame frames[TRACE_MAX_FRAMES];
+} TraceRecord;
+#pragma pack(pop)
+
+// Single-producer ring drained by the writer thread. head is only written by the
+// channel loop and tail only by the writer, so neither side takes a lock. Both count
+// records modulo 2^32; head - tail is the fill level even after they wrap.
+typedef struct {
+	TraceRecord* records;
+	uint32_t capacity;
+	volatile uint32_t head;  // Records published by the channel loop
+	volatile uint32_t tail;  // Records written out by the writer thread
+	volatile LONG stop;
+	FILE* fp;
+	HANDLE thread;
+	double start_ms;         // now_ms() at open, base for the record times
+	int64_t start_time_sec;  // Wall clock at open, base for the pcap timestamps
+	int64_t recorded;
+	int64_t dropped;         // Records lost because the ring was full
+} Trace;
+
+// Creates the pcap file and starts the writer thread. capacity must be a power of two.
+bool trace_open(Trace* trace, const char* path, uint32_t capacity);
+
+// Returns the next record to fill in (time_us already set), or NULL if the ring is full.
+// The record is handed to the writer by trace_commit().
+TraceRecord* trace_begin(Trace* trace);
+void trace_commit(Trace* trace);
+
+// Stops the writer thread after it has written every committed record.
+void trace_close(Trace* trace);
+
+#endif